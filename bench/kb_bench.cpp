@@ -0,0 +1,482 @@
+/*
+	Microbenchmarks of bevgrafmath2017.h and the spline kernels.
+
+	Every benchmark is run in a number of samples; a sample repeats the
+	measured operation until it takes at least MINIMUM_SAMPLE_TIME, and its
+	time per operation is recorded. The result is written as JSON (to stdout or
+	--output), with order statistics over the samples, which are far more
+	stable between runs than means.
+
+	Usage: kb_bench [--output file.json] [--filter text] [--samples N]
+	                [--max-points N] [--max-vertices N]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bevgrafmath2017.h"
+#include "kb_point_grid.h"
+#include "kb_spline.h"
+
+namespace {
+
+const double MINIMUM_SAMPLE_TIME = 0.002;
+
+// Operations slower than this get fewer samples, so that the 10 million point
+// runs stay within a few seconds each.
+const double SLOW_OPERATION_TIME = 0.05;
+const size_t SLOW_OPERATION_SAMPLE_COUNT = 5;
+
+const size_t STEPS_PER_SEGMENT = 20;
+const size_t QUERY_COUNT = 1024;
+
+// Matches CLICK_THRESHOLD of the GUI.
+const float CLICK_THRESHOLD = 100.0f;
+
+struct BenchmarkOptions {
+	const char *outputPath = nullptr;
+	const char *filter = nullptr;
+	size_t sampleCount = 15;
+	size_t maximumPointCount = 10000000;
+	size_t maximumVertexCount = 64000000;
+};
+
+struct BenchmarkResult {
+	std::string name;
+	size_t size;
+	const char *unit;
+	size_t sampleCount;
+	size_t iterationCount;
+	double minimum;
+	double median;
+	double percentile90;
+	double percentile99;
+	double maximum;
+};
+
+// Written by the benchmarks so that the compiler cannot drop their results.
+volatile float sink;
+
+void consume(const vec2& v) {
+	sink = v.x + v.y;
+}
+
+void consume(const vec4& v) {
+	sink = v.x + v.y + v.z + v.w;
+}
+
+void consume(const mat4& m) {
+	sink = m[0][0] + m[1][1] + m[2][2] + m[3][3];
+}
+
+void consume(const mat24& m) {
+	sink = m[0][0] + m[1][3];
+}
+
+double getTime() {
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+	return std::chrono::duration<double>(now).count();
+}
+
+double getPercentile(const std::vector<double>& sortedValues, const double percentile) {
+	const size_t index = (size_t)(percentile / 100.0 * (double)(sortedValues.size() - 1) + 0.5);
+
+	return sortedValues[std::min(index, sortedValues.size() - 1)];
+}
+
+class BenchmarkRunner {
+public:
+	explicit BenchmarkRunner(const BenchmarkOptions& options) : mOptions(options) {
+	}
+
+	bool isSelected(const std::string& name) const {
+		return mOptions.filter == nullptr || name.find(mOptions.filter) != std::string::npos;
+	}
+
+	// operation runs the measured code once; its time is divided by
+	// operationSize (e.g. the number of vertices written) for the result.
+	void run(
+		const std::string& name,
+		const size_t size,
+		const char *unit,
+		const double operationSize,
+		const std::function<void()>& operation
+	) {
+		if (!isSelected(name)) {
+			return;
+		}
+
+		// Warm-up, which also calibrates the iteration count.
+		double startTime = getTime();
+		operation();
+		const double operationTime = std::max(getTime() - startTime, 1e-9);
+
+		const size_t iterationCount = std::max<size_t>((size_t)(MINIMUM_SAMPLE_TIME / operationTime), 1);
+		const size_t sampleCount = operationTime > SLOW_OPERATION_TIME
+			? std::min(mOptions.sampleCount, SLOW_OPERATION_SAMPLE_COUNT)
+			: mOptions.sampleCount;
+
+		std::vector<double> samples(sampleCount);
+
+		for (auto& sample : samples) {
+			startTime = getTime();
+
+			for (size_t iteration = 0; iteration < iterationCount; ++iteration) {
+				operation();
+			}
+
+			sample = (getTime() - startTime) * 1e9 / ((double)iterationCount * operationSize);
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		mResults.push_back({
+			name,
+			size,
+			unit,
+			sampleCount,
+			iterationCount,
+			samples.front(),
+			getPercentile(samples, 50.0),
+			getPercentile(samples, 90.0),
+			getPercentile(samples, 99.0),
+			samples.back()
+		});
+
+		fprintf(stderr, "%-40s %10zu %12.3f %s\n", name.c_str(), size, mResults.back().median, unit);
+	}
+
+	bool writeJson() const {
+		FILE *file = mOptions.outputPath != nullptr ? fopen(mOptions.outputPath, "w") : stdout;
+
+		if (file == nullptr) {
+			return false;
+		}
+
+		fprintf(file, "{\n");
+		fprintf(file, "  \"version\": 1,\n");
+		fprintf(file, "  \"simdLevel\": \"%s\",\n", getSimdLevelName(getSupportedSimdLevel()));
+		fprintf(file, "  \"stepsPerSegment\": %zu,\n", STEPS_PER_SEGMENT);
+		fprintf(file, "  \"benchmarks\": [\n");
+
+		for (size_t i = 0; i < mResults.size(); ++i) {
+			const BenchmarkResult& result = mResults[i];
+
+			fprintf(file,
+				"    { \"name\": \"%s\", \"size\": %zu, \"unit\": \"%s\", \"samples\": %zu, \"iterations\": %zu, "
+				"\"min\": %.4f, \"median\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+				result.name.c_str(),
+				result.size,
+				result.unit,
+				result.sampleCount,
+				result.iterationCount,
+				result.minimum,
+				result.median,
+				result.percentile90,
+				result.percentile99,
+				result.maximum,
+				i + 1 < mResults.size() ? "," : ""
+			);
+		}
+
+		fprintf(file, "  ]\n}\n");
+
+		return file == stdout || fclose(file) == 0;
+	}
+
+private:
+	const BenchmarkOptions& mOptions;
+	std::vector<BenchmarkResult> mResults;
+};
+
+std::vector<vec2> generatePoints(const size_t count, std::mt19937& random) {
+	// Roughly the density of a window-sized curve, scaled with the count so
+	// that grid cells hold a similar number of points at every size.
+	const float extent = 100.0f * sqrtf((float)std::max<size_t>(count, 100));
+	std::uniform_real_distribution<float> coordinate(0.0f, extent);
+
+	std::vector<vec2> points(count);
+
+	for (auto& point : points) {
+		point = { coordinate(random), coordinate(random) };
+	}
+
+	return points;
+}
+
+std::vector<size_t> getSizes(const size_t maximumSize) {
+	std::vector<size_t> sizes;
+
+	for (size_t size = 10; size <= maximumSize; size *= 10) {
+		sizes.push_back(size);
+	}
+
+	return sizes;
+}
+
+void runMathBenchmarks(BenchmarkRunner& runner, std::mt19937& random) {
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+	// Cycling through a small array keeps the inputs in L1 but unknown to the
+	// compiler.
+	const size_t INPUT_COUNT = 256;
+
+	std::vector<mat24> geometries(INPUT_COUNT);
+	std::vector<mat4> matrices(INPUT_COUNT);
+	std::vector<vec4> vectors(INPUT_COUNT);
+
+	for (size_t i = 0; i < INPUT_COUNT; ++i) {
+		geometries[i] = {
+			vec2(value(random), value(random)),
+			vec2(value(random), value(random)),
+			vec2(value(random), value(random)),
+			vec2(value(random), value(random))
+		};
+		matrices[i] = calculateCoefficientMatrix(value(random), value(random), value(random));
+		vectors[i] = vec4(value(random), value(random), value(random), 1.0f);
+	}
+
+	runner.run("mat24 * mat4", INPUT_COUNT, "ns/op", (double)INPUT_COUNT, [&]() {
+		for (size_t i = 0; i < INPUT_COUNT; ++i) {
+			consume(geometries[i] * matrices[(i + 1) % INPUT_COUNT]);
+		}
+	});
+
+	runner.run("mat24 * vec4", INPUT_COUNT, "ns/op", (double)INPUT_COUNT, [&]() {
+		for (size_t i = 0; i < INPUT_COUNT; ++i) {
+			consume(geometries[i] * vectors[(i + 1) % INPUT_COUNT]);
+		}
+	});
+
+	runner.run("mat4 * vec4", INPUT_COUNT, "ns/op", (double)INPUT_COUNT, [&]() {
+		for (size_t i = 0; i < INPUT_COUNT; ++i) {
+			consume(matrices[i] * vectors[(i + 1) % INPUT_COUNT]);
+		}
+	});
+
+	runner.run("inverse(mat4)", INPUT_COUNT, "ns/op", (double)INPUT_COUNT, [&]() {
+		for (size_t i = 0; i < INPUT_COUNT; ++i) {
+			consume(inverse(matrices[i]));
+		}
+	});
+
+	runner.run("calculateCoefficientMatrix", INPUT_COUNT, "ns/op", (double)INPUT_COUNT, [&]() {
+		for (size_t i = 0; i < INPUT_COUNT; ++i) {
+			consume(calculateCoefficientMatrix(vectors[i].x, vectors[i].y, vectors[i].z));
+		}
+	});
+}
+
+void runSegmentBenchmarks(BenchmarkRunner& runner, std::mt19937& random) {
+	const std::vector<vec2> points = generatePoints(4, random);
+	const mat4 coefficientMatrix = calculateCoefficientMatrix(0.0f, 0.0f, 0.0f);
+	const mat24 segmentMatrix = calculateSegmentMatrix(0, coefficientMatrix, points.data());
+
+	std::vector<vec2> output(STEPS_PER_SEGMENT);
+
+	runner.run("calculateSegmentMatrix", 1, "ns/op", 1.0, [&]() {
+		consume(calculateSegmentMatrix(0, coefficientMatrix, points.data()));
+	});
+
+	runner.run("tessellateSegment", STEPS_PER_SEGMENT, "ns/vertex", (double)STEPS_PER_SEGMENT, [&]() {
+		tessellateSegment(segmentMatrix, STEPS_PER_SEGMENT, output.data());
+		consume(output.back());
+	});
+
+	runner.run("tessellateSegmentForwardDifferencing", STEPS_PER_SEGMENT, "ns/vertex", (double)STEPS_PER_SEGMENT, [&]() {
+		tessellateSegmentForwardDifferencing(segmentMatrix, STEPS_PER_SEGMENT, output.data());
+		consume(output.back());
+	});
+}
+
+void runCurveBenchmarks(BenchmarkRunner& runner, const BenchmarkOptions& options, std::mt19937& random) {
+	const char *methodNames[] = { "Matrix", "ForwardDifferencing", "Simd", "BasisTable" };
+	const TessellationMethod methods[] = {
+		TessellationMethod::Matrix,
+		TessellationMethod::ForwardDifferencing,
+		TessellationMethod::Simd,
+		TessellationMethod::BasisTable
+	};
+
+	BasisTable basisTable;
+	updateBasisTable(basisTable, 0.0f, 0.0f, 0.0f, STEPS_PER_SEGMENT);
+
+	for (const size_t size : getSizes(options.maximumPointCount)) {
+		const size_t vertexCount = getTessellatedVertexCount(size, STEPS_PER_SEGMENT);
+
+		if (vertexCount > options.maximumVertexCount) {
+			fprintf(stderr, "Skipping tessellation of %zu points, see --max-vertices\n", size);
+			continue;
+		}
+
+		const std::vector<vec2> points = generatePoints(size, random);
+		std::vector<vec2> output(vertexCount);
+
+		for (size_t methodIndex = 0; methodIndex < 4; ++methodIndex) {
+			const std::string name = std::string("tessellateCurve/") + methodNames[methodIndex];
+
+			runner.run(name, size, "ns/vertex", (double)vertexCount, [&]() {
+				if (methods[methodIndex] == TessellationMethod::BasisTable) {
+					tessellateCurve(points.data(), points.size(), basisTable, output.data());
+				} else {
+					tessellateCurve(
+						points.data(),
+						points.size(),
+						basisTable.coefficientMatrix,
+						STEPS_PER_SEGMENT,
+						output.data(),
+						methods[methodIndex]
+					);
+				}
+
+				consume(output.back());
+			});
+		}
+	}
+}
+
+void runQueryBenchmarks(BenchmarkRunner& runner, const BenchmarkOptions& options, std::mt19937& random) {
+	for (const size_t size : getSizes(options.maximumPointCount)) {
+		const std::vector<vec2> points = generatePoints(size, random);
+
+		// Half of the queries hit a point, half of them land anywhere.
+		std::vector<vec2> queries(QUERY_COUNT);
+		const std::vector<vec2> misses = generatePoints(QUERY_COUNT, random);
+		std::uniform_int_distribution<size_t> pointIndex(0, size - 1);
+
+		for (size_t i = 0; i < QUERY_COUNT; ++i) {
+			queries[i] = i % 2 == 0 ? points[pointIndex(random)] + vec2(2.0f, -3.0f) : misses[i];
+		}
+
+		PointGrid grid;
+
+		runner.run("buildPointGrid", size, "ns/point", (double)size, [&]() {
+			buildPointGrid(grid, sqrtf(CLICK_THRESHOLD), points.data(), points.size());
+		});
+
+		buildPointGrid(grid, sqrtf(CLICK_THRESHOLD), points.data(), points.size());
+
+		runner.run("findGridPoint", size, "ns/query", (double)QUERY_COUNT, [&]() {
+			size_t found = 0;
+
+			for (const vec2& query : queries) {
+				found += findGridPoint(grid, points.data(), query, CLICK_THRESHOLD);
+			}
+
+			sink = (float)found;
+		});
+
+		// The linear scan the grid replaced, for comparison at small sizes.
+		if (size <= 100000) {
+			runner.run("linearPointSearch", size, "ns/query", (double)QUERY_COUNT, [&]() {
+				size_t found = 0;
+
+				for (const vec2& query : queries) {
+					const auto point = std::find_if(points.begin(), points.end(), [&query](const vec2& p) {
+						return dot(p - query, p - query) < CLICK_THRESHOLD;
+					});
+
+					found += point - points.begin();
+				}
+
+				sink = (float)found;
+			});
+		}
+	}
+}
+
+void runTransformBenchmarks(BenchmarkRunner& runner, const BenchmarkOptions& options, std::mt19937& random) {
+	// A pan and zoom of the whole scene.
+	const mat3 view = windowToViewport2(vec2(-20.0f, 35.0f), vec2(1024.0f, 768.0f), vec2(0.0f, 0.0f), vec2(1920.0f, 1080.0f));
+
+	for (const size_t size : getSizes(options.maximumPointCount)) {
+		const std::vector<vec2> points = generatePoints(size, random);
+		std::vector<vec2> output(size);
+
+		std::vector<float> x(size), y(size), outputX(size), outputY(size);
+		for (size_t i = 0; i < size; ++i) {
+			x[i] = points[i].x;
+			y[i] = points[i].y;
+		}
+
+		runner.run("mat3 * vec3 per point", size, "ns/point", (double)size, [&]() {
+			for (size_t i = 0; i < size; ++i) {
+				output[i] = hToIh(view * ihToH(points[i]));
+			}
+
+			consume(output.back());
+		});
+
+		runner.run("transformPoints(vec2)", size, "ns/point", (double)size, [&]() {
+			transformPoints(view, points.data(), output.data(), size);
+			consume(output.back());
+		});
+
+		runner.run("transformPoints(x, y)", size, "ns/point", (double)size, [&]() {
+			transformPoints(view, x.data(), y.data(), outputX.data(), outputY.data(), size);
+			sink = outputX.back();
+		});
+	}
+}
+
+bool parseOptions(const int argc, char **argv, BenchmarkOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		const bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--output") == 0 && hasValue) {
+			options.outputPath = argv[++i];
+		} else if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+			options.filter = argv[++i];
+		} else if (strcmp(argv[i], "--samples") == 0 && hasValue) {
+			options.sampleCount = (size_t)std::max(atoi(argv[++i]), 1);
+		} else if (strcmp(argv[i], "--max-points") == 0 && hasValue) {
+			options.maximumPointCount = (size_t)std::max(atoll(argv[++i]), 10LL);
+		} else if (strcmp(argv[i], "--max-vertices") == 0 && hasValue) {
+			options.maximumVertexCount = (size_t)std::max(atoll(argv[++i]), 1LL);
+		} else {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}
+
+int main(int argc, char **argv) {
+	BenchmarkOptions options;
+
+	if (!parseOptions(argc, argv, options)) {
+		fprintf(stderr,
+			"Usage: %s [--output file.json] [--filter text] [--samples N] [--max-points N] [--max-vertices N]\n",
+			argv[0]);
+		return -1;
+	}
+
+	// Fixed seed: every run measures the same inputs.
+	std::mt19937 random(2017);
+
+	BenchmarkRunner runner(options);
+
+	runMathBenchmarks(runner, random);
+	runSegmentBenchmarks(runner, random);
+	runCurveBenchmarks(runner, options, random);
+	runQueryBenchmarks(runner, options, random);
+	runTransformBenchmarks(runner, options, random);
+
+	if (!runner.writeJson()) {
+		fprintf(stderr, "Failed to write %s\n", options.outputPath);
+		return -1;
+	}
+
+	return 0;
+}
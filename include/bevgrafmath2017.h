@@ -6,6 +6,23 @@
 #include <assert.h>
 #include <stdio.h>
 
+// BGM_USE_SSE: a vec4 egy 16 bajtra igazitott SSE regiszterkent is
+// hasznalhato, es a vec4 / mat4 / mat24 muveletek SIMD utasitasokkal
+// szamolnak. FMA-t csak akkor hasznal, ha a fordito is arra fordit (__FMA__).
+// A kapcsolot minden forditasi egysegben egyforman kell megadni, mert a vec4
+// igazitasa megvaltozik.
+//
+// A pontsorozatokat transzformalo fuggvenyek a kapcsolotol fuggetlenul SSE2-t
+// hasznalnak, ha a cel platformon elerheto.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BGM_HAS_SSE2
+#include <immintrin.h>
+#endif
+
+#if defined(BGM_USE_SSE) && !defined(BGM_HAS_SSE2)
+#error "BGM_USE_SSE requires SSE2"
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // Konstansok formazashoz
 ///////////////////////////////////////////////////////////////////////////////
@@ -386,7 +403,11 @@ inline vec3& operator/=(vec3& v, float f)
 ///////////////////////////////////////////////////////////////////////////////
 // 4D vektor
 ///////////////////////////////////////////////////////////////////////////////
+#if defined(BGM_USE_SSE)
+struct alignas(16) vec4
+#else
 struct vec4
+#endif
 {
 	float x, y, z, w;
 
@@ -429,10 +450,58 @@ struct vec4
 		assert(ind >= 0 && ind <= 3);
 		return (&x)[ind];
 	}
+
+#if defined(BGM_USE_SSE)
+	explicit vec4(__m128 m)
+	{
+		_mm_store_ps(&x, m);
+	}
+
+	__m128 simd() const
+	{
+		return _mm_load_ps(&x);
+	}
+#endif
 };
 
+#if defined(BGM_HAS_SSE2)
+inline __m128 bgm_detail_splat(__m128 m, const int ind)
+{
+	switch (ind)
+	{
+	case 0: return _mm_shuffle_ps(m, m, _MM_SHUFFLE(0, 0, 0, 0));
+	case 1: return _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+	case 2: return _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2));
+	default: return _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+}
+
+// a * b + c
+inline __m128 bgm_detail_madd(__m128 a, __m128 b, __m128 c)
+{
+#if defined(__FMA__)
+	return _mm_fmadd_ps(a, b, c);
+#else
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+// A sorvektorok linearis kombinacioja: s[0] * r0 + s[1] * r1 + s[2] * r2 + s[3] * r3,
+// a skalar kodeval azonos sorrendben osszeadva.
+inline __m128 bgm_detail_combine(__m128 s, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+	__m128 result = _mm_mul_ps(bgm_detail_splat(s, 0), r0);
+	result = bgm_detail_madd(bgm_detail_splat(s, 1), r1, result);
+	result = bgm_detail_madd(bgm_detail_splat(s, 2), r2, result);
+	return bgm_detail_madd(bgm_detail_splat(s, 3), r3, result);
+}
+#endif
+
 inline vec4 operator-(vec4 v)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_xor_ps(_mm_set1_ps(-0.0f), v.simd()));
+#else
 	return vec4
 	{
 		-v[0],
@@ -440,11 +509,16 @@ inline vec4 operator-(vec4 v)
 		-v[2],
 		-v[3]
 	};
+#endif
 }
 
 inline bool operator==(vec4 v1, vec4 v2)
 {
+#if defined(BGM_USE_SSE)
+	return _mm_movemask_ps(_mm_cmpeq_ps(v1.simd(), v2.simd())) == 0xF;
+#else
 	return v1[0] == v2[0] && v1[1] == v2[1] && v1[2] == v2[2] && v1[3] == v2[3];
+#endif
 }
 
 inline bool operator!=(vec4 v1, vec4 v2)
@@ -454,6 +528,9 @@ inline bool operator!=(vec4 v1, vec4 v2)
 
 inline vec4 operator+(vec4 v1, vec4 v2)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_add_ps(v1.simd(), v2.simd()));
+#else
 	return vec4
 	{
 		v1[0] + v2[0],
@@ -461,10 +538,14 @@ inline vec4 operator+(vec4 v1, vec4 v2)
 		v1[2] + v2[2],
 		v1[3] + v2[3]
 	};
+#endif
 }
 
 inline vec4 operator-(vec4 v1, vec4 v2)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_sub_ps(v1.simd(), v2.simd()));
+#else
 	return vec4
 	{
 		v1[0] - v2[0],
@@ -472,6 +553,7 @@ inline vec4 operator-(vec4 v1, vec4 v2)
 		v1[2] - v2[2],
 		v1[3] - v2[3]
 	};
+#endif
 }
 
 inline vec4& operator+=(vec4& v1, vec4 v2)
@@ -488,6 +570,9 @@ inline vec4& operator-=(vec4& v1, vec4 v2)
 
 inline vec4 operator+(vec4 v, float f)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_add_ps(v.simd(), _mm_set1_ps(f)));
+#else
 	return vec4
 	{
 		v[0] + f,
@@ -495,10 +580,14 @@ inline vec4 operator+(vec4 v, float f)
 		v[2] + f,
 		v[3] + f
 	};
+#endif
 }
 
 inline vec4 operator-(vec4 v, float f)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_sub_ps(v.simd(), _mm_set1_ps(f)));
+#else
 	return vec4
 	{
 		v[0] - f,
@@ -506,10 +595,14 @@ inline vec4 operator-(vec4 v, float f)
 		v[2] - f,
 		v[3] - f
 	};
+#endif
 }
 
 inline vec4 operator*(vec4 v, float f)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_mul_ps(v.simd(), _mm_set1_ps(f)));
+#else
 	return vec4
 	{
 		v[0] * f,
@@ -517,10 +610,14 @@ inline vec4 operator*(vec4 v, float f)
 		v[2] * f,
 		v[3] * f
 	};
+#endif
 }
 
 inline vec4 operator/(vec4 v, float f)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_div_ps(v.simd(), _mm_set1_ps(f)));
+#else
 	return vec4
 	{
 		v[0] / f,
@@ -528,10 +625,14 @@ inline vec4 operator/(vec4 v, float f)
 		v[2] / f,
 		v[3] / f
 	};
+#endif
 }
 
 inline vec4 operator+(float f, vec4 v)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_add_ps(_mm_set1_ps(f), v.simd()));
+#else
 	return vec4
 	{
 		f + v[0],
@@ -539,10 +640,14 @@ inline vec4 operator+(float f, vec4 v)
 		f + v[2],
 		f + v[3]
 	};
+#endif
 }
 
 inline vec4 operator-(float f, vec4 v)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_sub_ps(_mm_set1_ps(f), v.simd()));
+#else
 	return vec4
 	{
 		f - v[0],
@@ -550,10 +655,14 @@ inline vec4 operator-(float f, vec4 v)
 		f - v[2],
 		f - v[3]
 	};
+#endif
 }
 
 inline vec4 operator*(float f, vec4 v)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_mul_ps(_mm_set1_ps(f), v.simd()));
+#else
 	return vec4
 	{
 		f * v[0],
@@ -561,10 +670,14 @@ inline vec4 operator*(float f, vec4 v)
 		f * v[2],
 		f * v[3]
 	};
+#endif
 }
 
 inline vec4 operator/(float f, vec4 v)
 {
+#if defined(BGM_USE_SSE)
+	return vec4(_mm_div_ps(_mm_set1_ps(f), v.simd()));
+#else
 	return vec4
 	{
 		f / v[0],
@@ -572,6 +685,7 @@ inline vec4 operator/(float f, vec4 v)
 		f / v[2],
 		f / v[3]
 	};
+#endif
 }
 
 inline vec4& operator+=(vec4& v, float f)
@@ -985,6 +1099,16 @@ inline mat4 operator*(mat4 m1, mat4 m2)
 {
 	mat4 result;
 
+#if defined(BGM_USE_SSE)
+	const __m128 r0 = m2[0].simd(), r1 = m2[1].simd(), r2 = m2[2].simd(), r3 = m2[3].simd();
+
+	for (size_t i = 0; i < 4; ++i)
+	{
+		result[i] = vec4(bgm_detail_combine(m1[i].simd(), r0, r1, r2, r3));
+	}
+
+	return result;
+#else
 	for (size_t i = 0; i < 4; ++i)
 	{
 		for (size_t j = 0; j < 4; ++j)
@@ -998,10 +1122,17 @@ inline mat4 operator*(mat4 m1, mat4 m2)
 	}
 
 	return result;
+#endif
 }
 
 inline vec4 operator*(mat4 m, vec4 v)
 {
+#if defined(BGM_USE_SSE)
+	__m128 c0 = m[0].simd(), c1 = m[1].simd(), c2 = m[2].simd(), c3 = m[3].simd();
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	return vec4(bgm_detail_combine(v.simd(), c0, c1, c2, c3));
+#else
 	return vec4
 	{
 		m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2] + m[0][3] * v[3],
@@ -1009,6 +1140,7 @@ inline vec4 operator*(mat4 m, vec4 v)
 		m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2] + m[2][3] * v[3],
 		m[3][0] * v[0] + m[3][1] * v[1] + m[3][2] * v[2] + m[3][3] * v[3]
 	};
+#endif
 }
 
 inline mat4& operator+=(mat4& m1, mat4 m2)
@@ -1236,6 +1368,14 @@ inline mat24 operator*(mat24 m1, mat4 m2)
 {
 	mat24 result;
 
+#if defined(BGM_USE_SSE)
+	const __m128 r0 = m2[0].simd(), r1 = m2[1].simd(), r2 = m2[2].simd(), r3 = m2[3].simd();
+
+	result[0] = vec4(bgm_detail_combine(m1[0].simd(), r0, r1, r2, r3));
+	result[1] = vec4(bgm_detail_combine(m1[1].simd(), r0, r1, r2, r3));
+
+	return result;
+#else
 	for (size_t i = 0; i < 2; ++i)
 	{
 		for (size_t j = 0; j < 4; ++j)
@@ -1249,15 +1389,26 @@ inline mat24 operator*(mat24 m1, mat4 m2)
 	}
 
 	return result;
+#endif
 }
 
 inline vec2 operator*(mat24 m, vec4 v)
 {
+#if defined(BGM_USE_SSE)
+	// Ket sor helyett negy oszlop: az x es y a regiszter also ket eleme.
+	__m128 c0 = m[0].simd(), c1 = m[1].simd(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	const vec4 result(bgm_detail_combine(v.simd(), c0, c1, c2, c3));
+
+	return vec2{ result.x, result.y };
+#else
 	return vec2
 	{
 		m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2] + m[0][3] * v[3],
 		m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2] + m[1][3] * v[3]
 	};
+#endif
 }
 
 inline mat24& operator+=(mat24& m1, mat24 m2)
@@ -1579,6 +1730,18 @@ inline mat3 transpose(mat3 m)
 
 inline mat4 transpose(mat4 m)
 {
+#if defined(BGM_USE_SSE)
+	__m128 r0 = m[0].simd(), r1 = m[1].simd(), r2 = m[2].simd(), r3 = m[3].simd();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	return mat4
+	{
+		vec4(r0),
+		vec4(r1),
+		vec4(r2),
+		vec4(r3)
+	};
+#else
 	return mat4
 	{
 		m.col(0),
@@ -1586,6 +1749,7 @@ inline mat4 transpose(mat4 m)
 		m.col(2),
 		m.col(3)
 	};
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1890,6 +2054,187 @@ inline mat4 cavalier(float angle, float shortening)
 	return result;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Pontsorozatok transzformalasa
+///////////////////////////////////////////////////////////////////////////////
+// Sok pont egy hivassal, kulon x, y (, z) tombokben (SoA). A kimenet lehet
+// maga a bemenet is (helyben transzformalas), de reszleges atfedes nem lehet.
+// Affin matrixnal elmarad a homogen osztas. Minden pont eredmenye
+// bitre megegyezik a hToIh(m * ihToH(v)) eredmenyevel.
+inline bool isAffine(mat3 m)
+{
+	return m[2][0] == 0.0f && m[2][1] == 0.0f && m[2][2] == 1.0f;
+}
+
+inline bool isAffine(mat4 m)
+{
+	return m[3][0] == 0.0f && m[3][1] == 0.0f && m[3][2] == 0.0f && m[3][3] == 1.0f;
+}
+
+inline void transformPoints(mat3 m, const float* x, const float* y, float* outX, float* outY, size_t count)
+{
+	const bool affine = isAffine(m);
+	size_t i = 0;
+
+#if defined(BGM_HAS_SSE2)
+	const __m128 m00 = _mm_set1_ps(m[0][0]), m01 = _mm_set1_ps(m[0][1]), m02 = _mm_set1_ps(m[0][2]);
+	const __m128 m10 = _mm_set1_ps(m[1][0]), m11 = _mm_set1_ps(m[1][1]), m12 = _mm_set1_ps(m[1][2]);
+	const __m128 m20 = _mm_set1_ps(m[2][0]), m21 = _mm_set1_ps(m[2][1]), m22 = _mm_set1_ps(m[2][2]);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 px = _mm_loadu_ps(x + i);
+		const __m128 py = _mm_loadu_ps(y + i);
+
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, px), _mm_mul_ps(m01, py)), m02);
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, px), _mm_mul_ps(m11, py)), m12);
+
+		if (!affine)
+		{
+			const __m128 rw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, px), _mm_mul_ps(m21, py)), m22);
+			rx = _mm_div_ps(rx, rw);
+			ry = _mm_div_ps(ry, rw);
+		}
+
+		_mm_storeu_ps(outX + i, rx);
+		_mm_storeu_ps(outY + i, ry);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const float px = x[i];
+		const float py = y[i];
+
+		float rx = m[0][0] * px + m[0][1] * py + m[0][2];
+		float ry = m[1][0] * px + m[1][1] * py + m[1][2];
+
+		if (!affine)
+		{
+			const float rw = m[2][0] * px + m[2][1] * py + m[2][2];
+			rx /= rw;
+			ry /= rw;
+		}
+
+		outX[i] = rx;
+		outY[i] = ry;
+	}
+}
+
+inline void transformPoints(mat3 m, float* x, float* y, size_t count)
+{
+	transformPoints(m, x, y, x, y, count);
+}
+
+inline void transformPoints(mat3 m, const vec2* points, vec2* output, size_t count)
+{
+	const bool affine = isAffine(m);
+	size_t i = 0;
+
+#if defined(BGM_HAS_SSE2)
+	const __m128 m00 = _mm_set1_ps(m[0][0]), m01 = _mm_set1_ps(m[0][1]), m02 = _mm_set1_ps(m[0][2]);
+	const __m128 m10 = _mm_set1_ps(m[1][0]), m11 = _mm_set1_ps(m[1][1]), m12 = _mm_set1_ps(m[1][2]);
+	const __m128 m20 = _mm_set1_ps(m[2][0]), m21 = _mm_set1_ps(m[2][1]), m22 = _mm_set1_ps(m[2][2]);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		// x0 y0 x1 y1 es x2 y2 x3 y3 szetvalogatasa x es y regiszterekbe.
+		const __m128 p01 = _mm_loadu_ps(&points[i].x);
+		const __m128 p23 = _mm_loadu_ps(&points[i + 2].x);
+		const __m128 px = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m128 py = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, px), _mm_mul_ps(m01, py)), m02);
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, px), _mm_mul_ps(m11, py)), m12);
+
+		if (!affine)
+		{
+			const __m128 rw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, px), _mm_mul_ps(m21, py)), m22);
+			rx = _mm_div_ps(rx, rw);
+			ry = _mm_div_ps(ry, rw);
+		}
+
+		_mm_storeu_ps(&output[i].x, _mm_unpacklo_ps(rx, ry));
+		_mm_storeu_ps(&output[i + 2].x, _mm_unpackhi_ps(rx, ry));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		transformPoints(m, &points[i].x, &points[i].y, &output[i].x, &output[i].y, 1);
+	}
+}
+
+inline void transformPoints(mat4 m, const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ, size_t count)
+{
+	const bool affine = isAffine(m);
+	size_t i = 0;
+
+#if defined(BGM_HAS_SSE2)
+	__m128 r[4][4];
+	for (size_t row = 0; row < 4; ++row)
+	{
+		for (size_t col = 0; col < 4; ++col)
+		{
+			r[row][col] = _mm_set1_ps(m[row][col]);
+		}
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 px = _mm_loadu_ps(x + i);
+		const __m128 py = _mm_loadu_ps(y + i);
+		const __m128 pz = _mm_loadu_ps(z + i);
+
+		__m128 result[4];
+		for (size_t row = 0; row < (affine ? 3u : 4u); ++row)
+		{
+			result[row] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(r[row][0], px), _mm_mul_ps(r[row][1], py)), _mm_mul_ps(r[row][2], pz)), r[row][3]);
+		}
+
+		if (!affine)
+		{
+			result[0] = _mm_div_ps(result[0], result[3]);
+			result[1] = _mm_div_ps(result[1], result[3]);
+			result[2] = _mm_div_ps(result[2], result[3]);
+		}
+
+		_mm_storeu_ps(outX + i, result[0]);
+		_mm_storeu_ps(outY + i, result[1]);
+		_mm_storeu_ps(outZ + i, result[2]);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const float px = x[i];
+		const float py = y[i];
+		const float pz = z[i];
+
+		float rx = m[0][0] * px + m[0][1] * py + m[0][2] * pz + m[0][3];
+		float ry = m[1][0] * px + m[1][1] * py + m[1][2] * pz + m[1][3];
+		float rz = m[2][0] * px + m[2][1] * py + m[2][2] * pz + m[2][3];
+
+		if (!affine)
+		{
+			const float rw = m[3][0] * px + m[3][1] * py + m[3][2] * pz + m[3][3];
+			rx /= rw;
+			ry /= rw;
+			rz /= rw;
+		}
+
+		outX[i] = rx;
+		outY[i] = ry;
+		outZ[i] = rz;
+	}
+}
+
+inline void transformPoints(mat4 m, float* x, float* y, float* z, size_t count)
+{
+	transformPoints(m, x, y, z, x, y, z, count);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Kiirato fuggvenyek
 ///////////////////////////////////////////////////////////////////////////////
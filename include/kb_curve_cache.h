@@ -0,0 +1,108 @@
+#ifndef H___KB_CURVE_CACHE
+#define H___KB_CURVE_CACHE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "kb_parallel.h"
+#include "kb_spline.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Incremental tessellation
+//
+// Keeps the tessellated curve between frames. Every segment owns the fixed
+// vertex span [i * steps, (i + 1) * steps), so editing a control point only
+// re-evaluates the (at most four) segments that use it. Changing the basis
+// table, the step count or the method re-evaluates everything.
+///////////////////////////////////////////////////////////////////////////////
+
+struct CurveCache {
+	std::vector<vec2> vertices;
+
+	// Half-open range of segments waiting for re-evaluation.
+	size_t dirtySegmentBegin = 0;
+	size_t dirtySegmentEnd = 0;
+	bool isAllDirty = true;
+
+	// The state the cached vertices were built with.
+	size_t controlPointCount = 0;
+	float tension = 0.0f;
+	float bias = 0.0f;
+	float continuity = 0.0f;
+	size_t stepsPerSegment = 0;
+	TessellationMethod method = TessellationMethod::Matrix;
+};
+
+// Vertices rewritten by the last update, e.g. for a partial buffer upload.
+struct VertexRange {
+	size_t first;
+	size_t count;
+};
+
+// The ranges changed by the last CHANGE_HISTORY_LENGTH versions of an array,
+// to bring an older copy of it up to date by copying only what changed since.
+// A recorded range must cover every element that differs from the previous
+// version, appended ones included.
+const size_t CHANGE_HISTORY_LENGTH = 16;
+
+struct ChangeHistory {
+	// Numbered from 1; a copy that never saw a version holds 0.
+	uint64_t version = 0;
+
+	// The range of version v is at v % CHANGE_HISTORY_LENGTH.
+	VertexRange ranges[CHANGE_HISTORY_LENGTH] = {};
+
+	// Versions up to this one are unrelated to the ones before them.
+	uint64_t lastFullChangeVersion = 0;
+};
+
+void recordChange(ChangeHistory& history, const VertexRange& range);
+void recordFullChange(ChangeHistory& history);
+
+// The union of the ranges changed after version. Fails if the history does
+// not reach back that far, or the array was replaced since.
+bool getChangesSince(const ChangeHistory& history, const uint64_t version, VertexRange& range);
+
+// Brings copy, which holds copyVersion of the array, up to date with the
+// current version, count elements at source.
+template <typename T>
+void updateCopy(std::vector<T>& copy, const uint64_t copyVersion, const ChangeHistory& history, const T *source, const size_t count) {
+	VertexRange range;
+
+	if (!getChangesSince(history, copyVersion, range)) {
+		copy.assign(source, source + count);
+		return;
+	}
+
+	copy.resize(count);
+
+	const size_t first = std::min(range.first, count);
+	const size_t end = std::min(range.first + range.count, count);
+
+	std::copy(source + first, source + end, copy.begin() + first);
+}
+
+void invalidateCurveCache(CurveCache& cache);
+
+// Marks the segments using the control point (including a newly appended one).
+void invalidateControlPoint(CurveCache& cache, const size_t controlPointIndex);
+
+// Marks every segment from the first one using the control point to the end,
+// for a point inserted or erased there, which shifts all later points.
+void invalidateControlPointsFrom(CurveCache& cache, const size_t controlPointIndex);
+
+// Re-evaluates the dirty segments, split across the thread pool if one is
+// given and the range is large enough to benefit.
+VertexRange updateCurveCache(
+	CurveCache& cache,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	TessellationThreadPool *threadPool = nullptr
+);
+
+#endif // !H___KB_CURVE_CACHE
@@ -0,0 +1,60 @@
+#ifndef H___KB_CURVE_EXPORT
+#define H___KB_CURVE_EXPORT
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "bevgrafmath2017.h"
+#include "kb_parallel.h"
+#include "kb_spline.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Curve export
+//
+// Streams a curve to a file as SVG path data or as a binary polyline. The
+// curve is evaluated CURVE_EXPORT_BATCH_VERTEX_COUNT vertices at a time, and
+// the text or binary output goes through a CURVE_EXPORT_BUFFER_SIZE byte
+// write buffer, so the memory used does not grow with the curve.
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t CURVE_EXPORT_BATCH_VERTEX_COUNT = 64 * 1024;
+const size_t CURVE_EXPORT_BUFFER_SIZE = 256 * 1024;
+
+enum class CurveExportFormat {
+	// A path of straight lines through the tessellated vertices.
+	SvgPolyline,
+	// A path of one cubic Bezier per segment. Exact, so it does not depend on
+	// the step count or the tessellation method.
+	SvgBezier,
+	// The tessellated vertices as a point file (see kb_point_file.h), with the
+	// TCB parameters of the curve in its header.
+	PointFile
+};
+
+struct CurveExportStatistics {
+	size_t segmentCount = 0;
+	// Points written: tessellated vertices, or Bezier end and control points.
+	size_t pointCount = 0;
+	size_t byteCount = 0;
+	double seconds = 0.0;
+};
+
+// The Bezier control points of the cubic a segment matrix describes.
+void calculateBezierControlPoints(const mat24& segmentMatrix, vec2 bezierPoints[4]);
+
+// Writes the curve of the basis table's parameters and step count, tessellated
+// the same way tessellateCurveParallel() does. A null pool evaluates on the
+// calling thread only. Returns false if a write failed; the output is not
+// closed either way.
+bool exportCurve(
+	FILE *output,
+	const CurveExportFormat format,
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	CurveExportStatistics *statistics = nullptr
+);
+
+#endif // !H___KB_CURVE_EXPORT
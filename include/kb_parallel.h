@@ -0,0 +1,58 @@
+#ifndef H___KB_PARALLEL
+#define H___KB_PARALLEL
+
+#include <stddef.h>
+
+#include <functional>
+
+#include "kb_spline.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Parallel tessellation
+//
+// Splits a segment range into chunks and evaluates them on Eigen's
+// non-blocking (work-stealing) thread pool. Every chunk writes its fixed
+// vertex span of the shared output buffer, so there is nothing to merge
+// afterwards. The calling thread evaluates chunks as well, so a pool of N
+// threads runs N - 1 workers.
+///////////////////////////////////////////////////////////////////////////////
+
+struct TessellationThreadPool;
+
+// Number of hardware threads, at least 1.
+size_t getHardwareThreadCount();
+
+// threadCount includes the calling thread; 1 creates no worker threads.
+TessellationThreadPool *createTessellationThreadPool(const size_t threadCount);
+void destroyTessellationThreadPool(TessellationThreadPool *pool);
+
+size_t getThreadCount(const TessellationThreadPool *pool);
+
+// Runs runChunk(0) .. runChunk(chunkCount - 1) on the pool and the calling
+// thread, in no particular order, and returns once all of them have. Also
+// usable for work other than tessellation.
+void runChunksParallel(TessellationThreadPool *pool, const size_t chunkCount, const std::function<void(size_t)>& runChunk);
+
+// Same output as tessellateSegments() with the basis table (method is
+// BasisTable) or with its coefficient matrix (any other method). A null pool
+// evaluates on the calling thread only.
+void tessellateSegmentsParallel(
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t firstSegment,
+	const size_t segmentCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	vec2 *output
+);
+
+size_t tessellateCurveParallel(
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	vec2 *output
+);
+
+#endif // !H___KB_PARALLEL
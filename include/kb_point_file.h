@@ -0,0 +1,72 @@
+#ifndef H___KB_POINT_FILE
+#define H___KB_POINT_FILE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bevgrafmath2017.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Binary control point files
+//
+// A 64 byte header followed by the points as packed x, y floats, in native
+// (little-endian) byte order. The points start at a multiple of
+// POINT_FILE_ALIGNMENT, so a memory-mapped file can be handed to the
+// evaluator as a vec2 array without parsing or copying; pages are only read
+// once something touches them.
+///////////////////////////////////////////////////////////////////////////////
+
+const uint32_t POINT_FILE_VERSION = 1;
+const size_t POINT_FILE_ALIGNMENT = 64;
+
+struct PointFileHeader {
+	char magic[8];       // "KBPOINTS"
+	uint32_t version;
+	uint32_t dataOffset; // from the start of the file
+	uint64_t pointCount;
+	float tension;
+	float bias;
+	float continuity;
+	uint32_t reserved[7];
+};
+
+static_assert(sizeof(PointFileHeader) == POINT_FILE_ALIGNMENT, "The points must follow the header aligned");
+static_assert(sizeof(vec2) == 2 * sizeof(float), "vec2 must be packed to read points in place");
+
+struct MappedPointFile {
+	// Valid until closePointFile().
+	const vec2 *points = nullptr;
+	size_t pointCount = 0;
+
+	float tension = 0.0f;
+	float bias = 0.0f;
+	float continuity = 0.0f;
+
+	const void *mapping = nullptr;
+	size_t mappingSize = 0;
+};
+
+// Maps the file read-only. Fails on anything that is not a complete point
+// file of a known version.
+bool openPointFile(MappedPointFile& file, const char *path);
+void closePointFile(MappedPointFile& file);
+
+// The header of a file whose points directly follow it, for writers that
+// stream the points instead of handing over an array.
+PointFileHeader makePointFileHeader(
+	const size_t pointCount,
+	const float tension,
+	const float bias,
+	const float continuity
+);
+
+bool writePointFile(
+	const char *path,
+	const vec2 *points,
+	const size_t pointCount,
+	const float tension,
+	const float bias,
+	const float continuity
+);
+
+#endif // !H___KB_POINT_FILE
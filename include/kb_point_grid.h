@@ -0,0 +1,56 @@
+#ifndef H___KB_POINT_GRID
+#define H___KB_POINT_GRID
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "bevgrafmath2017.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Uniform grid over the control points
+//
+// Answers "nearest point within a radius" queries by looking at the 3x3 cells
+// around the query position instead of every point. The grid stores point
+// indices and is kept up to date incrementally as points are added, moved,
+// inserted or erased.
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t NO_GRID_POINT = (size_t)-1;
+
+struct PointGrid {
+	// Should be at least the query radius, so that a query never has to look
+	// further than the neighbouring cells.
+	float cellSize = 1.0f;
+
+	std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+};
+
+void buildPointGrid(PointGrid& grid, const float cellSize, const vec2 *points, const size_t pointCount);
+
+void insertGridPoint(PointGrid& grid, const size_t pointIndex, const vec2 position);
+void moveGridPoint(PointGrid& grid, const size_t pointIndex, const vec2 oldPosition, const vec2 newPosition);
+
+// For a point inserted into the middle of the point array, which shifts the
+// indices of the later points up by one. points is the array after the
+// insertion. Only the shifted points are renumbered, the grid is not rebuilt.
+void insertShiftedGridPoint(PointGrid& grid, const vec2 *points, const size_t pointCount, const size_t pointIndex);
+
+// The same for a point erased from the middle; points is the array after the
+// erasure.
+void eraseShiftedGridPoint(
+	PointGrid& grid,
+	const vec2 *points,
+	const size_t pointCount,
+	const size_t pointIndex,
+	const vec2 erasedPosition
+);
+
+// The index of the point nearest to position whose squared distance is at
+// most maximumDistance2 (the lowest index among equally near ones), or
+// NO_GRID_POINT. maximumDistance2 must not exceed cellSize^2.
+size_t findGridPoint(const PointGrid& grid, const vec2 *points, const vec2 position, const float maximumDistance2);
+
+#endif // !H___KB_POINT_GRID
@@ -0,0 +1,61 @@
+#ifndef H___KB_POINT_IMPORT
+#define H___KB_POINT_IMPORT
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <functional>
+#include <vector>
+
+#include "bevgrafmath2017.h"
+#include "kb_parallel.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Text point import
+//
+// Reads one point per line as "x, y", "x;y" or "x y" (any further columns are
+// ignored). Blank lines and lines starting with '#' are skipped; lines that
+// do not start with two numbers, like a CSV header, are counted as rejected.
+//
+// The input is read in blocks of POINT_IMPORT_BLOCK_SIZE bytes. Every block is
+// split into chunks at line boundaries, and the chunks are parsed in parallel
+// with std::from_chars, each straight into its place in the output.
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t POINT_IMPORT_BLOCK_SIZE = 16 * 1024 * 1024;
+
+struct PointImportStatistics {
+	size_t byteCount = 0;
+	size_t pointCount = 0;
+	size_t rejectedLineCount = 0;
+	double seconds = 0.0;
+};
+
+// Megabytes (10^6 bytes) of text per second.
+double getImportThroughput(const PointImportStatistics& statistics);
+
+// Parses the whole input into points, replacing its contents. The points are
+// not copied once parsed, apart from closing the gaps of lines without a point.
+// A file is read twice, its lines are counted first, so points is reserved
+// once for one point per line. A pipe (e.g. stdin) is read once, and points
+// grows geometrically meanwhile; each reallocation briefly holds both the old
+// and the new buffer.
+bool importPointText(
+	FILE *input,
+	TessellationThreadPool *pool,
+	std::vector<vec2>& points,
+	PointImportStatistics& statistics
+);
+
+// Hands the points of every block to onPoints as soon as it is parsed, so
+// only one block of text is held at a time; for reading from a pipe.
+// statistics is kept up to date meanwhile, so onPoints can report progress
+// from its byteCount.
+bool streamPointText(
+	FILE *input,
+	TessellationThreadPool *pool,
+	const std::function<void(const vec2 *points, size_t pointCount)>& onPoints,
+	PointImportStatistics& statistics
+);
+
+#endif // !H___KB_POINT_IMPORT
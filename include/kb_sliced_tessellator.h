@@ -0,0 +1,82 @@
+#ifndef H___KB_SLICED_TESSELLATOR
+#define H___KB_SLICED_TESSELLATOR
+
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include "kb_curve_cache.h"
+#include "kb_spline.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Time-sliced tessellation
+//
+// Evaluates a curve on the calling thread, a time budget at a time, for
+// targets that cannot spawn threads. The evaluation runs as a coroutine
+// (libcoro) that yields back to the caller whenever the budget of the current
+// resume() is spent, so a frame never waits for more than one slice.
+//
+// Like the curve cache, only the segments around changed points are
+// re-evaluated. Until a slice reaches them, changed segments keep their old
+// vertices, so the curve is refreshed progressively.
+///////////////////////////////////////////////////////////////////////////////
+
+class SlicedTessellator {
+public:
+	SlicedTessellator();
+	~SlicedTessellator();
+
+	// Allocates the coroutine stack. Returns false on failure.
+	bool init();
+	void free();
+
+	// Takes a copy of the control points and marks the segments that differ
+	// from the previous ones for evaluation.
+	void start(
+		const vec2 *controlPoints,
+		const size_t controlPointCount,
+		const BasisTable& basisTable,
+		const TessellationMethod method
+	);
+
+	// Evaluates until everything is done or timeBudget seconds have passed.
+	// Returns true if the curve is complete.
+	bool resume(const double timeBudget);
+
+	bool isFinished() const;
+
+	// The curve as far as it is evaluated; vertices of new segments that were
+	// not reached yet are not included.
+	const vec2 *getVertices() const;
+	size_t getVertexCount() const;
+
+	// Vertices written since the last call.
+	VertexRange takeChangedRange();
+
+private:
+	struct Coroutine;
+
+	static void run(void *argument);
+	void tessellate();
+	void markChanged(const size_t firstVertex, const size_t vertexCount);
+
+	std::unique_ptr<Coroutine> mCoroutine;
+
+	std::vector<vec2> mControlPoints;
+	std::vector<vec2> mVertices;
+	BasisTable mBasisTable;
+	TessellationMethod mMethod = TessellationMethod::Matrix;
+
+	// Segments still waiting for evaluation, and whether the closing vertex
+	// has to be written once they are done.
+	size_t mDirtySegmentBegin = 0;
+	size_t mDirtySegmentEnd = 0;
+	bool mIsCloseNeeded = false;
+
+	size_t mValidVertexCount = 0;
+	VertexRange mChangedRange = { 0, 0 };
+	double mDeadline = 0.0;
+};
+
+#endif // !H___KB_SLICED_TESSELLATOR
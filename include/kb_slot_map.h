@@ -0,0 +1,202 @@
+#ifndef H___KB_SLOT_MAP
+#define H___KB_SLOT_MAP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Generational slot map
+//
+// Values are stored densely and in order, so the evaluator can read them as
+// one contiguous array. A handle stays valid until its value is erased, no
+// matter how the dense array is reallocated or shifted, and a handle to an
+// erased value is detected through the generation counter of its slot.
+//
+// Appending and erasing the last value are O(1). Because the curve order is
+// part of the data, inserting or erasing in the middle shifts the tail of the
+// dense array (a memmove) and re-points the slots of the shifted values.
+///////////////////////////////////////////////////////////////////////////////
+
+struct SlotHandle {
+	uint32_t slot;
+	uint32_t generation;
+};
+
+const SlotHandle NULL_SLOT_HANDLE = { UINT32_MAX, 0 };
+
+inline bool operator==(SlotHandle h1, SlotHandle h2)
+{
+	return h1.slot == h2.slot && h1.generation == h2.generation;
+}
+
+inline bool operator!=(SlotHandle h1, SlotHandle h2)
+{
+	return !(h1 == h2);
+}
+
+template <typename T>
+class SlotMap {
+public:
+	size_t size() const { return mValues.size(); }
+	bool empty() const { return mValues.empty(); }
+
+	T *data() { return mValues.data(); }
+	const T *data() const { return mValues.data(); }
+
+	T& operator[](const size_t index) { return mValues[index]; }
+	const T& operator[](const size_t index) const { return mValues[index]; }
+
+	typename std::vector<T>::iterator begin() { return mValues.begin(); }
+	typename std::vector<T>::iterator end() { return mValues.end(); }
+	typename std::vector<T>::const_iterator begin() const { return mValues.begin(); }
+	typename std::vector<T>::const_iterator end() const { return mValues.end(); }
+
+	void reserve(const size_t capacity) {
+		mValues.reserve(capacity);
+		mDenseToSlot.reserve(capacity);
+		mSlots.reserve(capacity);
+	}
+
+	void clear() {
+		for (size_t index = 0; index < mValues.size(); ++index) {
+			releaseSlot(mDenseToSlot[index]);
+		}
+
+		mValues.clear();
+		mDenseToSlot.clear();
+	}
+
+	SlotHandle pushBack(const T& value) {
+		const uint32_t slot = acquireSlot((uint32_t)mValues.size());
+
+		mValues.push_back(value);
+		mDenseToSlot.push_back(slot);
+
+		return { slot, mSlots[slot].generation };
+	}
+
+	// Appends count values with a single reservation.
+	void append(const T *values, const size_t count) {
+		reserve(mValues.size() + count);
+
+		for (size_t i = 0; i < count; ++i) {
+			pushBack(values[i]);
+		}
+	}
+
+	// Replaces the values with the vector's, taking over its buffer instead
+	// of copying them.
+	void assign(std::vector<T>&& values) {
+		clear();
+
+		mValues = std::move(values);
+		mDenseToSlot.resize(mValues.size());
+
+		for (size_t index = 0; index < mValues.size(); ++index) {
+			mDenseToSlot[index] = acquireSlot((uint32_t)index);
+		}
+	}
+
+	SlotHandle insert(const size_t index, const T& value) {
+		const uint32_t slot = acquireSlot((uint32_t)index);
+
+		mValues.insert(mValues.begin() + index, value);
+		mDenseToSlot.insert(mDenseToSlot.begin() + index, slot);
+
+		updateSlots(index + 1);
+
+		return { slot, mSlots[slot].generation };
+	}
+
+	bool erase(const SlotHandle handle) {
+		if (!contains(handle)) {
+			return false;
+		}
+
+		const size_t index = mSlots[handle.slot].index;
+
+		releaseSlot(handle.slot);
+
+		mValues.erase(mValues.begin() + index);
+		mDenseToSlot.erase(mDenseToSlot.begin() + index);
+
+		updateSlots(index);
+
+		return true;
+	}
+
+	bool contains(const SlotHandle handle) const {
+		return
+			handle.slot < mSlots.size() &&
+			mSlots[handle.slot].generation == handle.generation &&
+			mSlots[handle.slot].isUsed;
+	}
+
+	T *get(const SlotHandle handle) {
+		return contains(handle) ? &mValues[mSlots[handle.slot].index] : nullptr;
+	}
+
+	const T *get(const SlotHandle handle) const {
+		return contains(handle) ? &mValues[mSlots[handle.slot].index] : nullptr;
+	}
+
+	// Position of the value in the dense array. The handle must be valid.
+	size_t indexOf(const SlotHandle handle) const {
+		return mSlots[handle.slot].index;
+	}
+
+	SlotHandle handleAt(const size_t index) const {
+		const uint32_t slot = mDenseToSlot[index];
+
+		return { slot, mSlots[slot].generation };
+	}
+
+private:
+	struct Slot {
+		// Dense index while used, the next free slot while free.
+		uint32_t index;
+		uint32_t generation;
+		bool isUsed;
+	};
+
+	uint32_t acquireSlot(const uint32_t index) {
+		uint32_t slot;
+
+		if (mFreeSlot != UINT32_MAX) {
+			slot = mFreeSlot;
+			mFreeSlot = mSlots[slot].index;
+		} else {
+			slot = (uint32_t)mSlots.size();
+			mSlots.push_back({ 0, 0, false });
+		}
+
+		mSlots[slot].index = index;
+		mSlots[slot].isUsed = true;
+
+		return slot;
+	}
+
+	void releaseSlot(const uint32_t slot) {
+		// A new generation invalidates every handle to the old value.
+		++mSlots[slot].generation;
+		mSlots[slot].isUsed = false;
+		mSlots[slot].index = mFreeSlot;
+		mFreeSlot = slot;
+	}
+
+	void updateSlots(const size_t firstIndex) {
+		for (size_t index = firstIndex; index < mDenseToSlot.size(); ++index) {
+			mSlots[mDenseToSlot[index]].index = (uint32_t)index;
+		}
+	}
+
+	std::vector<T> mValues;
+	std::vector<uint32_t> mDenseToSlot;
+	std::vector<Slot> mSlots;
+	uint32_t mFreeSlot = UINT32_MAX;
+};
+
+#endif // !H___KB_SLOT_MAP
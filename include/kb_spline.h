@@ -0,0 +1,185 @@
+#ifndef H___KB_SPLINE
+#define H___KB_SPLINE
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "bevgrafmath2017.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Kochanek-Bartels spline evaluation
+//
+// Headless evaluator shared by the GUI and offline tools. Control points are
+// read from a contiguous array and the curve is written as a single line strip
+// into a caller-supplied buffer: every segment contributes its samples for
+// t in [0, 1) and the last segment also closes the curve with its t = 1 point,
+// so neighbouring segments never duplicate their shared end point.
+///////////////////////////////////////////////////////////////////////////////
+
+const size_t MINIMUM_NUMBER_OF_CONTROL_POINTS = 4;
+
+enum class TessellationMethod {
+	// Builds { t^3, t^2, t, 1 } and multiplies it with the segment matrix.
+	Matrix,
+	// Three vector additions per sample. For window-sized coordinates the
+	// accumulated rounding stays below 0.02 pixels up to 256 steps per segment.
+	ForwardDifferencing,
+	// Matrix form evaluated for 4 (SSE2) or 8 (AVX2) samples at once, picked by
+	// runtime CPU detection. Bit-identical to Matrix as long as the scalar path
+	// is not compiled with floating-point contraction (FMA); otherwise the two
+	// differ by at most a few ulps.
+	Simd,
+	// Weighted sum of the four control points with weights from a BasisTable.
+	// Differs from Matrix only by rounding, a few thousandths of a pixel for
+	// window-sized coordinates.
+	BasisTable
+};
+
+enum class SimdLevel {
+	Scalar,
+	Sse2,
+	Avx2
+};
+
+// The widest instruction set the running CPU supports, detected once.
+SimdLevel getSupportedSimdLevel();
+const char *getSimdLevelName(const SimdLevel level);
+
+mat4 calculateCoefficientMatrix(const float tension, const float bias, const float continuity);
+
+// Number of cubic segments spanned by the control points (0 if too few).
+size_t getSegmentCount(const size_t controlPointCount);
+
+// Number of vertices tessellateCurve() writes for the given point count.
+size_t getTessellatedVertexCount(const size_t controlPointCount, const size_t stepsPerSegment);
+
+// The geometry matrix of a segment multiplied by the coefficient matrix.
+mat24 calculateSegmentMatrix(const size_t segmentIndex, const mat4& coefficientMatrix, const vec2 *controlPoints);
+
+// Writes the samples t = i / stepsPerSegment, i = 0 .. stepsPerSegment - 1.
+void tessellateSegment(const mat24& segmentMatrix, const size_t stepsPerSegment, vec2 *output);
+void tessellateSegmentForwardDifferencing(const mat24& segmentMatrix, const size_t stepsPerSegment, vec2 *output);
+
+// Tessellates every segment into output, which must hold at least
+// getTessellatedVertexCount() vertices. Returns the number of vertices written.
+// The overloads taking a coefficient matrix build a throwaway table for
+// TessellationMethod::BasisTable on every call, and assert in debug builds;
+// pass a BasisTable to the overloads below instead.
+size_t tessellateCurve(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	vec2 *output,
+	const TessellationMethod method = TessellationMethod::Matrix
+);
+
+// Writes the samples of segments [firstSegment, firstSegment + segmentCount)
+// to their place in the full curve, output + firstSegment * stepsPerSegment,
+// but not the closing t = 1 vertex. Disjoint ranges write disjoint vertices,
+// so they can be evaluated concurrently into the same buffer.
+void tessellateSegments(
+	const vec2 *controlPoints,
+	const size_t firstSegment,
+	const size_t segmentCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	vec2 *output,
+	const TessellationMethod method = TessellationMethod::Matrix
+);
+
+// Writes the closing t = 1 vertex of the curve, if it has any segments.
+void closeCurve(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	vec2 *output,
+	const TessellationMethod method = TessellationMethod::Matrix
+);
+
+// Per-sample basis weights M * { t^3, t^2, t, 1 } for a fixed step count. The
+// weights are the same for every segment, so a sample becomes a 4-term
+// weighted sum of control points. weights holds stepsPerSegment + 1 entries,
+// the last one belongs to t = 1.
+struct BasisTable {
+	float tension = 0.0f;
+	float bias = 0.0f;
+	float continuity = 0.0f;
+	size_t stepsPerSegment = 0;
+
+	mat4 coefficientMatrix;
+	std::vector<vec4> weights;
+};
+
+// Rebuilds the table only if one of the parameters changed. Returns true if
+// the table was rebuilt.
+bool updateBasisTable(
+	BasisTable& table,
+	const float tension,
+	const float bias,
+	const float continuity,
+	const size_t stepsPerSegment
+);
+
+size_t tessellateCurve(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	vec2 *output
+);
+
+void tessellateSegments(
+	const vec2 *controlPoints,
+	const size_t firstSegment,
+	const size_t segmentCount,
+	const BasisTable& basisTable,
+	vec2 *output
+);
+
+void closeCurve(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	vec2 *output
+);
+
+struct AdaptiveTessellationStatistics {
+	size_t segmentCount = 0;
+	size_t vertexCount = 0;
+	size_t minimumSegmentVertexCount = 0;
+	size_t maximumSegmentVertexCount = 0;
+	// Segments that hit maximumVerticesPerSegment before becoming flat.
+	size_t cappedSegmentCount = 0;
+};
+
+// Subdivides every segment until each span deviates from its chord by at most
+// flatnessTolerance (in the units of the control points, i.e. screen pixels
+// for the GUI). A segment never gets more than maximumVerticesPerSegment
+// vertices. The curve replaces the contents of output; returns its size.
+size_t tessellateCurveAdaptive(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const mat4& coefficientMatrix,
+	const float flatnessTolerance,
+	const size_t maximumVerticesPerSegment,
+	std::vector<vec2>& output,
+	AdaptiveTessellationStatistics *statistics = nullptr
+);
+
+// Structure-of-arrays variant of tessellateCurve(): coordinates are read from
+// and written to separate x / y arrays. Levels above getSupportedSimdLevel()
+// fall back to the supported one.
+size_t tessellateCurveSoA(
+	const float *controlX,
+	const float *controlY,
+	const size_t controlPointCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	float *outputX,
+	float *outputY,
+	const SimdLevel level = getSupportedSimdLevel()
+);
+
+#endif // !H___KB_SPLINE
@@ -0,0 +1,98 @@
+#ifndef H___KB_TESSELLATION_WORKER
+#define H___KB_TESSELLATION_WORKER
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kb_curve_cache.h"
+#include "kb_parallel.h"
+#include "kb_spline.h"
+#include "kb_triple_buffer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Background tessellation
+//
+// A worker thread that turns control point snapshots into vertex buffers.
+// Snapshots and results are exchanged through triple buffers, so submitting a
+// snapshot and picking up the latest result never block the render thread.
+// Only the newest snapshot is evaluated; older ones are skipped.
+//
+// The worker keeps its own curve cache, and every snapshot carries the ranges
+// of control points changed by its last versions, so dragging a point
+// re-evaluates only the segments around it. The buffers of both sides are
+// reused and only patched with what changed since the version they hold.
+///////////////////////////////////////////////////////////////////////////////
+
+struct TessellationRequest {
+	// controlPoints holds controlPointChanges.version; see updateCopy().
+	std::vector<vec2> controlPoints;
+	ChangeHistory controlPointChanges;
+
+	BasisTable basisTable;
+	TessellationMethod method = TessellationMethod::Matrix;
+
+	bool isAdaptive = false;
+	float flatnessTolerance = 0.25f;
+	size_t maximumVerticesPerSegment = 64;
+};
+
+struct TessellationResult {
+	std::vector<vec2> vertices;
+	AdaptiveTessellationStatistics statistics;
+
+	// The version of the worker's vertex history the vertices hold.
+	uint64_t vertexVersion = 0;
+
+	// Numbered from 1 in publication order.
+	uint64_t sequence = 0;
+
+	// Vertices that differ from the result with sequence - 1.
+	VertexRange changedRange = { 0, 0 };
+};
+
+class TessellationWorker {
+public:
+	// onResultPublished is called on the worker thread, e.g. to wake up an
+	// event loop that waits for input.
+	void start(TessellationThreadPool *threadPool, const std::function<void()>& onResultPublished);
+	void stop();
+
+	// Fill the request buffer, then submit it.
+	TessellationRequest& getRequestBuffer();
+	void submitRequest();
+
+	// Returns true if a newer result was published since the last call; the
+	// result stays valid until the next call.
+	bool fetchResult();
+	const TessellationResult& getResult() const;
+
+private:
+	void run();
+	void tessellate(TessellationRequest& request, TessellationResult& result);
+
+	TripleBuffer<TessellationRequest> mRequests;
+	TripleBuffer<TessellationResult> mResults;
+
+	std::thread mThread;
+	std::atomic<bool> mIsStopping{ false };
+	std::mutex mWakeUpMutex;
+	std::condition_variable mWakeUp;
+
+	std::function<void()> mOnResultPublished;
+	TessellationThreadPool *mThreadPool = nullptr;
+
+	// Used by the worker thread only.
+	CurveCache mCurveCache;
+	uint64_t mControlPointVersion = 0;
+	ChangeHistory mVertexChanges;
+	uint64_t mSequence = 0;
+};
+
+#endif // !H___KB_TESSELLATION_WORKER
@@ -0,0 +1,70 @@
+#ifndef H___KB_TRACE
+#define H___KB_TRACE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+///////////////////////////////////////////////////////////////////////////////
+// Trace recorder
+//
+// Records named time spans into per-thread ring buffers and writes them as
+// Chrome Trace Event JSON, which chrome://tracing and Perfetto can open.
+// Recording takes no locks: every thread appends to its own buffer, and only
+// the first event of a thread registers that buffer. When a buffer is full
+// the oldest events are overwritten.
+//
+// While tracing is off, a scope costs a single relaxed atomic load.
+///////////////////////////////////////////////////////////////////////////////
+
+extern std::atomic<bool> isTracing;
+
+inline bool isTraceEnabled() {
+	return isTracing.load(std::memory_order_relaxed);
+}
+
+// eventsPerThread is the size of each thread's ring buffer.
+void startTrace(const size_t eventsPerThread = 65536);
+
+// Stops recording and writes every buffered event. Must not race with
+// threads that are still recording. Returns false if the file could not be
+// written.
+bool writeTrace(const char *path);
+
+// Names the calling thread in the trace viewer.
+void setTraceThreadName(const char *name);
+
+// Nanoseconds on a monotonic clock.
+uint64_t getTraceTime();
+
+// name must outlive the trace, e.g. a string literal.
+void recordTraceEvent(const char *name, const uint64_t startTime, const uint64_t endTime);
+
+class TraceScope {
+public:
+	explicit TraceScope(const char *name)
+		: mName(name), mStartTime(isTraceEnabled() ? getTraceTime() : 0) {
+	}
+
+	~TraceScope() {
+		if (mStartTime != 0 && isTraceEnabled()) {
+			recordTraceEvent(mName, mStartTime, getTraceTime());
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char *mName;
+	uint64_t mStartTime;
+};
+
+#define KB_TRACE_CONCATENATE_(a, b) a##b
+#define KB_TRACE_CONCATENATE(a, b) KB_TRACE_CONCATENATE_(a, b)
+
+// Records the rest of the enclosing block as one event.
+#define KB_TRACE_SCOPE(name) TraceScope KB_TRACE_CONCATENATE(traceScope, __LINE__)(name)
+
+#endif // !H___KB_TRACE
@@ -0,0 +1,68 @@
+#ifndef H___KB_TRIPLE_BUFFER
+#define H___KB_TRIPLE_BUFFER
+
+#include <stdint.h>
+
+#include <atomic>
+
+///////////////////////////////////////////////////////////////////////////////
+// Lock-free triple buffer
+//
+// Hands the latest value from one producer thread to one consumer thread.
+// The producer fills the write buffer and publishes it, the consumer picks up
+// the latest published buffer; neither side ever waits for the other. Values
+// published faster than they are consumed are overwritten, so the consumer
+// only ever sees the newest one.
+//
+// The buffers are reused, which lets vectors inside T keep their capacity.
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class TripleBuffer {
+public:
+	// Producer side: the buffer to fill before publish().
+	T& getWriteBuffer() { return mBuffers[mWriteIndex]; }
+
+	void publish() {
+		const uint8_t previous = mMiddle.exchange(mWriteIndex | IS_FRESH, std::memory_order_acq_rel);
+
+		mWriteIndex = previous & INDEX_MASK;
+	}
+
+	// Consumer side: true if something was published since the last update().
+	bool hasUpdate() const {
+		return (mMiddle.load(std::memory_order_acquire) & IS_FRESH) != 0;
+	}
+
+	// Swaps in the latest published buffer. Returns false (and keeps the read
+	// buffer) if nothing new was published.
+	bool update() {
+		if (!hasUpdate()) {
+			return false;
+		}
+
+		const uint8_t previous = mMiddle.exchange(mReadIndex, std::memory_order_acq_rel);
+
+		mReadIndex = previous & INDEX_MASK;
+
+		return true;
+	}
+
+	T& getReadBuffer() { return mBuffers[mReadIndex]; }
+	const T& getReadBuffer() const { return mBuffers[mReadIndex]; }
+
+private:
+	static const uint8_t INDEX_MASK = 0x3;
+	static const uint8_t IS_FRESH = 0x4;
+
+	T mBuffers[3];
+
+	// Owned by the producer and the consumer respectively.
+	uint8_t mWriteIndex = 0;
+	uint8_t mReadIndex = 1;
+
+	// The buffer in between, and whether it holds an unread value.
+	std::atomic<uint8_t> mMiddle{ 2 };
+};
+
+#endif // !H___KB_TRIPLE_BUFFER
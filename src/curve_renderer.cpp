@@ -0,0 +1,249 @@
+#include "curve_renderer.h"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+const char *VERTEX_SHADER =
+	"#version 130\n"
+	"uniform mat4 projection;\n"
+	"in vec2 position;\n"
+	"void main() {\n"
+	"	gl_Position = projection * vec4(position, 0.0, 1.0);\n"
+	"}\n";
+
+const char *FRAGMENT_SHADER =
+	"#version 130\n"
+	"uniform vec4 color;\n"
+	"out vec4 fragmentColor;\n"
+	"void main() {\n"
+	"	fragmentColor = color;\n"
+	"}\n";
+
+// Control points are stored row by row in a two-channel float texture. 1024 is
+// the smallest GL_MAX_TEXTURE_SIZE that OpenGL 3.0 guarantees.
+const int CONTROL_POINT_TEXTURE_WIDTH = 1024;
+
+// Evaluates vertex gl_VertexID of the line strip written by tessellateCurve():
+// sample i of segment s is vertex s * stepsPerSegment + i, and the last vertex
+// is the t = 1 end of the last segment. Drawn without vertex attributes.
+const char *GPU_CURVE_VERTEX_SHADER =
+	"#version 130\n"
+	"uniform mat4 projection;\n"
+	"uniform mat4 coefficientMatrix;\n"
+	"uniform sampler2D controlPoints;\n"
+	"uniform int stepsPerSegment;\n"
+	"uniform int segmentCount;\n"
+	"vec2 fetchControlPoint(int index) {\n"
+	"	ivec2 texel = ivec2(index % CONTROL_POINT_TEXTURE_WIDTH, index / CONTROL_POINT_TEXTURE_WIDTH);\n"
+	"	return texelFetch(controlPoints, texel, 0).xy;\n"
+	"}\n"
+	"void main() {\n"
+	"	int segment = gl_VertexID / stepsPerSegment;\n"
+	"	float t = float(gl_VertexID - segment * stepsPerSegment) * (1.0 / float(stepsPerSegment));\n"
+	"	if (segment >= segmentCount) {\n"
+	"		segment = segmentCount - 1;\n"
+	"		t = 1.0;\n"
+	"	}\n"
+	"	vec4 weights = coefficientMatrix * vec4(t * t * t, t * t, t, 1.0);\n"
+	"	vec2 position =\n"
+	"		weights.x * fetchControlPoint(segment + 0) +\n"
+	"		weights.y * fetchControlPoint(segment + 1) +\n"
+	"		weights.z * fetchControlPoint(segment + 2) +\n"
+	"		weights.w * fetchControlPoint(segment + 3);\n"
+	"	gl_Position = projection * vec4(position, 0.0, 1.0);\n"
+	"}\n";
+
+const nanogui::Vector4f CURVE_COLOR(255.0f / 255.0f, 171.0f / 255.0f, 64.0f / 255.0f, 1.0f);
+const nanogui::Vector4f CONTROL_COLOR(1.0f, 1.0f, 1.0f, 1.0f);
+
+}
+
+bool CurveRenderer::init() {
+	const bool isInitialized =
+		mCurveShader.init("curve", VERTEX_SHADER, FRAGMENT_SHADER) &&
+		mControlPolygonShader.init("control_polygon", VERTEX_SHADER, FRAGMENT_SHADER) &&
+		mControlPointShader.init("control_points", VERTEX_SHADER, FRAGMENT_SHADER);
+
+	mGpuCurveShader.define("CONTROL_POINT_TEXTURE_WIDTH", std::to_string(CONTROL_POINT_TEXTURE_WIDTH));
+
+	if (!isInitialized || !mGpuCurveShader.init("gpu_curve", GPU_CURVE_VERTEX_SHADER, FRAGMENT_SHADER)) {
+		return false;
+	}
+
+	glGenTextures(1, &mControlPointTexture);
+	glBindTexture(GL_TEXTURE_2D, mControlPointTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Allocate the buffers up front so that the control points can share the
+	// buffer of the control polygon.
+	uploadPositions(mCurveShader, nullptr, 0);
+	uploadPositions(mControlPolygonShader, nullptr, 0);
+
+	mControlPointShader.bind();
+	mControlPointShader.shareAttrib(mControlPolygonShader, "position");
+
+	mProjection.setIdentity();
+
+	return true;
+}
+
+void CurveRenderer::free() {
+	if (mControlPointTexture != 0) {
+		glDeleteTextures(1, &mControlPointTexture);
+		mControlPointTexture = 0;
+	}
+
+	mGpuCurveShader.free();
+	mControlPointShader.free();
+	mControlPolygonShader.free();
+	mCurveShader.free();
+}
+
+void CurveRenderer::setFrameBufferSize(const int width, const int height) {
+	mProjection = nanogui::ortho(0.0f, (float)width, (float)height, 0.0f, 0.0f, 1.0f);
+}
+
+void CurveRenderer::uploadCurve(const vec2 *vertices, const size_t vertexCount, const VertexRange& changedRange) {
+	if (!mIsCurveUploaded || vertexCount != mCurveVertexCount) {
+		uploadPositions(mCurveShader, vertices, vertexCount);
+
+		mCurveVertexCount = vertexCount;
+		mIsCurveUploaded = true;
+	} else if (changedRange.count > 0) {
+		updatePositions(mCurveShader, vertices, changedRange);
+	}
+}
+
+void CurveRenderer::uploadControlPoints(const vec2 *controlPoints, const size_t controlPointCount) {
+	uploadPositions(mControlPolygonShader, controlPoints, controlPointCount);
+
+	mControlPointCount = controlPointCount;
+}
+
+void CurveRenderer::invalidate() {
+	mIsCurveUploaded = false;
+}
+
+void CurveRenderer::drawCurve() {
+	mCurveShader.bind();
+	mCurveShader.setUniform("projection", mProjection);
+	mCurveShader.setUniform("color", CURVE_COLOR);
+
+	glLineWidth(2.5f);
+	mCurveShader.drawArray(GL_LINE_STRIP, 0, (uint32_t)mCurveVertexCount);
+}
+
+void CurveRenderer::drawControlPolygon() {
+	mControlPolygonShader.bind();
+	mControlPolygonShader.setUniform("projection", mProjection);
+	mControlPolygonShader.setUniform("color", CONTROL_COLOR);
+
+	glLineWidth(1.5f);
+	mControlPolygonShader.drawArray(GL_LINE_STRIP, 0, (uint32_t)mControlPointCount);
+}
+
+void CurveRenderer::drawControlPoints() {
+	mControlPointShader.bind();
+	mControlPointShader.setUniform("projection", mProjection);
+	mControlPointShader.setUniform("color", CONTROL_COLOR);
+
+	mControlPointShader.drawArray(GL_POINTS, 0, (uint32_t)mControlPointCount);
+}
+
+void CurveRenderer::uploadControlPointTexture(const vec2 *controlPoints, const size_t controlPointCount) {
+	mTextureControlPointCount = controlPointCount;
+
+	if (controlPointCount == 0) {
+		return;
+	}
+
+	const size_t width = std::min(controlPointCount, (size_t)CONTROL_POINT_TEXTURE_WIDTH);
+	const size_t fullRowCount = controlPointCount / CONTROL_POINT_TEXTURE_WIDTH;
+	const size_t lastRowLength = controlPointCount % CONTROL_POINT_TEXTURE_WIDTH;
+	const size_t rowCount = fullRowCount + (lastRowLength > 0 ? 1 : 0);
+
+	glBindTexture(GL_TEXTURE_2D, mControlPointTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, (GLsizei)width, (GLsizei)rowCount, 0, GL_RG, GL_FLOAT, nullptr);
+
+	// The full rows in one go, the partial last row separately.
+	if (fullRowCount > 0) {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)width, (GLsizei)fullRowCount, GL_RG, GL_FLOAT, controlPoints);
+	}
+
+	if (lastRowLength > 0) {
+		glTexSubImage2D(
+			GL_TEXTURE_2D, 0,
+			0, (GLint)fullRowCount,
+			(GLsizei)lastRowLength, 1,
+			GL_RG, GL_FLOAT,
+			controlPoints + fullRowCount * CONTROL_POINT_TEXTURE_WIDTH
+		);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void CurveRenderer::drawGpuCurve(const mat4& coefficientMatrix, const size_t stepsPerSegment) {
+	const size_t segmentCount = getSegmentCount(mTextureControlPointCount);
+	const size_t vertexCount = getTessellatedVertexCount(mTextureControlPointCount, stepsPerSegment);
+
+	if (vertexCount == 0) {
+		return;
+	}
+
+	nanogui::Matrix4f coefficients;
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			coefficients(row, column) = coefficientMatrix[row][column];
+		}
+	}
+
+	mGpuCurveShader.bind();
+	mGpuCurveShader.setUniform("projection", mProjection);
+	mGpuCurveShader.setUniform("coefficientMatrix", coefficients);
+	mGpuCurveShader.setUniform("controlPoints", 0);
+	mGpuCurveShader.setUniform("stepsPerSegment", (int)stepsPerSegment);
+	mGpuCurveShader.setUniform("segmentCount", (int)segmentCount);
+	mGpuCurveShader.setUniform("color", CURVE_COLOR);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, mControlPointTexture);
+
+	glLineWidth(2.5f);
+	mGpuCurveShader.drawArray(GL_LINE_STRIP, 0, (uint32_t)vertexCount);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void CurveRenderer::uploadPositions(nanogui::GLShader& shader, const vec2 *positions, const size_t count) {
+	// vec2 is two packed floats, so the array maps onto a 2 x count matrix.
+	const float *data = positions != nullptr ? &positions->x : nullptr;
+	const Eigen::Map<const nanogui::MatrixXf> positionMatrix(data, 2, count);
+
+	shader.bind();
+	shader.uploadAttrib("position", positionMatrix);
+}
+
+void CurveRenderer::updatePositions(nanogui::GLShader& shader, const vec2 *positions, const VertexRange& range) {
+	shader.bind();
+
+	// GLShader has no partial upload, so look up the buffer bound to the
+	// attribute in the shader's vertex array object.
+	GLint bufferId = 0;
+	glGetVertexAttribiv(shader.attrib("position"), GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &bufferId);
+
+	glBindBuffer(GL_ARRAY_BUFFER, (GLuint)bufferId);
+	glBufferSubData(
+		GL_ARRAY_BUFFER,
+		(GLintptr)(range.first * sizeof(vec2)),
+		(GLsizeiptr)(range.count * sizeof(vec2)),
+		positions + range.first
+	);
+}
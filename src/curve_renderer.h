@@ -0,0 +1,57 @@
+#ifndef H___CURVE_RENDERER
+#define H___CURVE_RENDERER
+
+#include <nanogui/glutil.h>
+
+#include "bevgrafmath2017.h"
+#include "kb_curve_cache.h"
+
+// Retained-mode renderer: the curve and the control points live in vertex
+// buffers, and every layer is drawn with a single drawArray call. Only uses
+// features that are also available in a core profile context.
+class CurveRenderer {
+public:
+	bool init();
+	void free();
+
+	void setFrameBufferSize(const int width, const int height);
+
+	// Uploads only changedRange if the vertex count did not change since the
+	// last upload, the whole buffer otherwise.
+	void uploadCurve(const vec2 *vertices, const size_t vertexCount, const VertexRange& changedRange);
+	// The control polygon and the control points share one buffer.
+	void uploadControlPoints(const vec2 *controlPoints, const size_t controlPointCount);
+
+	// Forces a full upload next time, e.g. after the buffers were bypassed.
+	void invalidate();
+
+	void drawCurve();
+	void drawControlPolygon();
+	void drawControlPoints();
+
+	// GPU-side evaluation: only the control points (as a texture) and the
+	// coefficient matrix are uploaded, and the vertex shader evaluates the
+	// curve from gl_VertexID. The sample count costs no upload at all.
+	void uploadControlPointTexture(const vec2 *controlPoints, const size_t controlPointCount);
+	void drawGpuCurve(const mat4& coefficientMatrix, const size_t stepsPerSegment);
+
+private:
+	void uploadPositions(nanogui::GLShader& shader, const vec2 *positions, const size_t count);
+	void updatePositions(nanogui::GLShader& shader, const vec2 *positions, const VertexRange& range);
+
+	nanogui::GLShader mCurveShader;
+	nanogui::GLShader mControlPolygonShader;
+	nanogui::GLShader mControlPointShader;
+	nanogui::GLShader mGpuCurveShader;
+
+	GLuint mControlPointTexture = 0;
+	size_t mTextureControlPointCount = 0;
+
+	nanogui::Matrix4f mProjection;
+
+	size_t mCurveVertexCount = 0;
+	size_t mControlPointCount = 0;
+	bool mIsCurveUploaded = false;
+};
+
+#endif // !H___CURVE_RENDERER
@@ -0,0 +1,171 @@
+#include "frame_profiler.h"
+
+#include <algorithm>
+
+namespace {
+
+// A bit more than 4 seconds at 60 Hz.
+const size_t HISTORY_SIZE = 256;
+
+float toMilliseconds(const uint64_t nanoseconds) {
+	return (float)((double)nanoseconds / 1e6);
+}
+
+const char *FRAME_STAGE_NAMES[FRAME_STAGE_COUNT] = {
+	"Events",
+	"Basis table",
+	"Tessellation",
+	"Curve",
+	"Control polygon",
+	"Control points",
+	"Widgets",
+	"Swap"
+};
+
+}
+
+const char *getFrameStageName(const FrameStage stage) {
+	return FRAME_STAGE_NAMES[(size_t)stage];
+}
+
+FrameProfiler::FrameProfiler() {
+	std::fill(mCurrentStageTimes, mCurrentStageTimes + FRAME_STAGE_COUNT, 0.0f);
+}
+
+void FrameProfiler::setEnabled(const bool isEnabled) {
+	if (isEnabled && !mIsEnabled) {
+		// Start over, the old history has a gap in it.
+		mFrameTimes.assign(HISTORY_SIZE, 0.0f);
+
+		for (auto& stageTimes : mStageTimes) {
+			stageTimes.assign(HISTORY_SIZE, 0.0f);
+		}
+
+		mNextFrame = 0;
+		mFrameCount = 0;
+	}
+
+	mIsEnabled = isEnabled;
+	mIsInFrame = false;
+	mPendingEventTime = 0;
+}
+
+void FrameProfiler::beginFrame() {
+	if (!isActive()) {
+		return;
+	}
+
+	mFrameStartTime = getTraceTime();
+	mStageStartTime = mFrameStartTime;
+	mIsInFrame = true;
+
+	std::fill(mCurrentStageTimes, mCurrentStageTimes + FRAME_STAGE_COUNT, 0.0f);
+}
+
+void FrameProfiler::endStage(const FrameStage stage) {
+	if (!mIsInFrame || !isActive()) {
+		return;
+	}
+
+	const uint64_t currentTime = getTraceTime();
+
+	if (isTraceEnabled()) {
+		recordTraceEvent(getFrameStageName(stage), mStageStartTime, currentTime);
+	}
+
+	mCurrentStageTimes[(size_t)stage] += toMilliseconds(currentTime - mStageStartTime);
+	mStageStartTime = currentTime;
+}
+
+void FrameProfiler::endFrame() {
+	if (!mIsInFrame || !isActive()) {
+		return;
+	}
+
+	mIsInFrame = false;
+
+	const uint64_t currentTime = getTraceTime();
+
+	if (isTraceEnabled()) {
+		recordTraceEvent("Frame", mFrameStartTime, currentTime);
+	}
+
+	const float eventTime = toMilliseconds(mPendingEventTime);
+	mPendingEventTime = 0;
+
+	if (!mIsEnabled) {
+		return;
+	}
+
+	mCurrentStageTimes[(size_t)FrameStage::Events] += eventTime;
+	mFrameTimes[mNextFrame] = toMilliseconds(currentTime - mFrameStartTime) + eventTime;
+
+	for (size_t stage = 0; stage < FRAME_STAGE_COUNT; ++stage) {
+		mStageTimes[stage][mNextFrame] = mCurrentStageTimes[stage];
+	}
+
+	mNextFrame = (mNextFrame + 1) % HISTORY_SIZE;
+	mFrameCount = std::min(mFrameCount + 1, HISTORY_SIZE);
+}
+
+void FrameProfiler::discardFrame() {
+	mIsInFrame = false;
+}
+
+void FrameProfiler::addEventTime(const uint64_t startTime, const uint64_t endTime) {
+	if (mIsInFrame || !isActive()) {
+		return;
+	}
+
+	if (isTraceEnabled()) {
+		recordTraceEvent(getFrameStageName(FrameStage::Events), startTime, endTime);
+	}
+
+	mPendingEventTime += endTime - startTime;
+}
+
+std::vector<float> FrameProfiler::getFrameTimeHistory() const {
+	std::vector<float> history;
+	history.reserve(mFrameCount);
+
+	const size_t oldestFrame = mFrameCount < HISTORY_SIZE ? 0 : mNextFrame;
+
+	for (size_t i = 0; i < mFrameCount; ++i) {
+		history.push_back(mFrameTimes[(oldestFrame + i) % HISTORY_SIZE]);
+	}
+
+	return history;
+}
+
+FrameTimeStatistics FrameProfiler::getFrameStatistics() const {
+	return calculateStatistics(mFrameTimes);
+}
+
+FrameTimeStatistics FrameProfiler::getStageStatistics(const FrameStage stage) const {
+	return calculateStatistics(mStageTimes[(size_t)stage]);
+}
+
+FrameTimeStatistics FrameProfiler::calculateStatistics(const std::vector<float>& ringBuffer) const {
+	FrameTimeStatistics statistics;
+
+	if (mFrameCount == 0) {
+		return statistics;
+	}
+
+	// Until the ring buffer is full, the recorded frames are at its start.
+	std::vector<float> times(ringBuffer.begin(), ringBuffer.begin() + mFrameCount);
+
+	float sum = 0.0f;
+	for (const float time : times) {
+		sum += time;
+	}
+
+	const size_t percentileIndex = (times.size() * 99) / 100;
+	std::nth_element(times.begin(), times.begin() + percentileIndex, times.end());
+
+	statistics.percentile99 = times[percentileIndex];
+	statistics.minimum = *std::min_element(times.begin(), times.end());
+	statistics.average = sum / (float)times.size();
+
+	return statistics;
+}
@@ -0,0 +1,114 @@
+#ifndef H___FRAME_PROFILER
+#define H___FRAME_PROFILER
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "kb_trace.h"
+
+// The parts of a frame, in the order they run.
+enum class FrameStage {
+	Events,
+	BasisTable,
+	Tessellation,
+	Curve,
+	ControlPolygon,
+	ControlPoints,
+	Widgets,
+	Swap,
+	Count
+};
+
+const size_t FRAME_STAGE_COUNT = (size_t)FrameStage::Count;
+
+const char *getFrameStageName(const FrameStage stage);
+
+struct FrameTimeStatistics {
+	float minimum = 0.0f;
+	float average = 0.0f;
+	float percentile99 = 0.0f;
+};
+
+// Splits frames into stages by wall-clock time and keeps the last few hundred
+// frames. A stage lasts from the end of the previous one, so the stages add
+// up to the frame time. Draw stages only measure the submission of the draw
+// calls; the GPU catching up shows up in the swap. Input callbacks that run
+// between frames, e.g. inside glfwWaitEventsTimeout(), are added to the
+// Events stage and the frame time of the next frame.
+//
+// Stages and frames are also recorded as trace events while a trace is
+// running. Every call returns right away if neither is needed.
+class FrameProfiler {
+public:
+	FrameProfiler();
+
+	void setEnabled(const bool isEnabled);
+	bool isEnabled() const { return mIsEnabled; }
+
+	// Enabled or tracing.
+	bool isActive() const { return mIsEnabled || isTraceEnabled(); }
+
+	// A frame that is begun but never ended is discarded by the next
+	// beginFrame(); a skipped frame has to be discarded right away, so that
+	// the input callbacks before the next one are counted.
+	void beginFrame();
+	void endStage(const FrameStage stage);
+	void endFrame();
+	void discardFrame();
+
+	// Time of an input callback, see FrameEventScope. Callbacks running inside
+	// a frame are already part of its Events stage.
+	void addEventTime(const uint64_t startTime, const uint64_t endTime);
+
+	size_t getFrameCount() const { return mFrameCount; }
+
+	// Frame times in milliseconds, oldest first.
+	std::vector<float> getFrameTimeHistory() const;
+
+	FrameTimeStatistics getFrameStatistics() const;
+	FrameTimeStatistics getStageStatistics(const FrameStage stage) const;
+
+private:
+	FrameTimeStatistics calculateStatistics(const std::vector<float>& ringBuffer) const;
+
+	bool mIsEnabled = false;
+	bool mIsInFrame = false;
+
+	// In getTraceTime() nanoseconds.
+	uint64_t mFrameStartTime = 0;
+	uint64_t mStageStartTime = 0;
+	float mCurrentStageTimes[FRAME_STAGE_COUNT];
+	// Callback time since the last frame ended.
+	uint64_t mPendingEventTime = 0;
+
+	// Ring buffers of the last HISTORY_SIZE frames; mNextFrame is the oldest.
+	std::vector<float> mFrameTimes;
+	std::vector<float> mStageTimes[FRAME_STAGE_COUNT];
+	size_t mNextFrame = 0;
+	size_t mFrameCount = 0;
+};
+
+// Times the rest of the enclosing input callback into the Events stage.
+class FrameEventScope {
+public:
+	explicit FrameEventScope(FrameProfiler& profiler)
+		: mProfiler(profiler), mStartTime(profiler.isActive() ? getTraceTime() : 0) {
+	}
+
+	~FrameEventScope() {
+		if (mStartTime != 0) {
+			mProfiler.addEventTime(mStartTime, getTraceTime());
+		}
+	}
+
+	FrameEventScope(const FrameEventScope&) = delete;
+	FrameEventScope& operator=(const FrameEventScope&) = delete;
+
+private:
+	FrameProfiler& mProfiler;
+	uint64_t mStartTime;
+};
+
+#endif // !H___FRAME_PROFILER
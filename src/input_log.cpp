@@ -0,0 +1,205 @@
+#include "input_log.h"
+
+#include <string.h>
+
+namespace {
+
+const char MAGIC[4] = { 'K', 'B', 'I', 'L' };
+const uint32_t VERSION = 1;
+
+template <typename T>
+void write(FILE *file, const T& value) {
+	fwrite(&value, sizeof(T), 1, file);
+}
+
+template <typename T>
+bool read(FILE *file, T& value) {
+	return fread(&value, sizeof(T), 1, file) == 1;
+}
+
+// The number of int32 values and whether x, y follow, per event type.
+void getPayloadLayout(const InputEventType type, size_t& valueCount, bool& hasPosition) {
+	valueCount = 0;
+	hasPosition = false;
+
+	switch (type) {
+	case InputEventType::CursorPosition:
+	case InputEventType::Scroll:
+		hasPosition = true;
+		break;
+	case InputEventType::MouseButton:
+		valueCount = 3;
+		break;
+	case InputEventType::Key:
+		valueCount = 4;
+		break;
+	case InputEventType::Character:
+		valueCount = 1;
+		break;
+	case InputEventType::FrameBufferSize:
+		valueCount = 2;
+		break;
+	case InputEventType::FrameEnd:
+		break;
+	}
+}
+
+}
+
+bool InputRecorder::open(const char *path, const int windowWidth, const int windowHeight, const double startTime) {
+	close();
+
+	mFile = fopen(path, "wb");
+
+	if (mFile == nullptr) {
+		return false;
+	}
+
+	fwrite(MAGIC, sizeof(MAGIC), 1, mFile);
+	write(mFile, VERSION);
+	write(mFile, (int32_t)windowWidth);
+	write(mFile, (int32_t)windowHeight);
+
+	mStartTime = startTime;
+	mIsFrameEmpty = true;
+
+	return true;
+}
+
+void InputRecorder::close() {
+	if (mFile != nullptr) {
+		fclose(mFile);
+		mFile = nullptr;
+	}
+}
+
+void InputRecorder::record(const InputEvent& event) {
+	if (mFile == nullptr) {
+		return;
+	}
+
+	size_t valueCount;
+	bool hasPosition;
+	getPayloadLayout(event.type, valueCount, hasPosition);
+
+	write(mFile, (uint8_t)event.type);
+	write(mFile, event.time - mStartTime);
+
+	for (size_t i = 0; i < valueCount; ++i) {
+		write(mFile, event.values[i]);
+	}
+
+	if (hasPosition) {
+		write(mFile, event.x);
+		write(mFile, event.y);
+	}
+
+	mIsFrameEmpty = mIsFrameEmpty && event.type == InputEventType::FrameEnd;
+}
+
+void InputRecorder::endFrame(const double time) {
+	if (mFile == nullptr || mIsFrameEmpty) {
+		return;
+	}
+
+	record({ InputEventType::FrameEnd, time, { 0, 0, 0, 0 }, 0.0, 0.0 });
+
+	mIsFrameEmpty = true;
+}
+
+bool InputPlayer::open(const char *path) {
+	FILE *file = fopen(path, "rb");
+
+	if (file == nullptr) {
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version;
+	int32_t windowWidth, windowHeight;
+
+	const bool isHeaderValid =
+		fread(magic, sizeof(magic), 1, file) == 1 &&
+		memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 &&
+		read(file, version) && version == VERSION &&
+		read(file, windowWidth) &&
+		read(file, windowHeight);
+
+	if (!isHeaderValid) {
+		fclose(file);
+		return false;
+	}
+
+	mEvents.clear();
+	mNextEvent = 0;
+	mFrameCount = 0;
+	mWindowWidth = windowWidth;
+	mWindowHeight = windowHeight;
+
+	uint8_t type;
+
+	while (read(file, type)) {
+		if (type > (uint8_t)InputEventType::FrameEnd) {
+			fclose(file);
+			return false;
+		}
+
+		InputEvent event = { (InputEventType)type, 0.0, { 0, 0, 0, 0 }, 0.0, 0.0 };
+
+		size_t valueCount;
+		bool hasPosition;
+		getPayloadLayout(event.type, valueCount, hasPosition);
+
+		bool isComplete = read(file, event.time);
+
+		for (size_t i = 0; i < valueCount; ++i) {
+			isComplete = isComplete && read(file, event.values[i]);
+		}
+
+		if (hasPosition) {
+			isComplete = isComplete && read(file, event.x) && read(file, event.y);
+		}
+
+		// A recording cut short (e.g. by a crash) is replayed up to there.
+		if (!isComplete) {
+			break;
+		}
+
+		mEvents.push_back(event);
+
+		if (event.type == InputEventType::FrameEnd) {
+			++mFrameCount;
+		}
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+double InputPlayer::getNextFrameTime() const {
+	for (size_t i = mNextEvent; i < mEvents.size(); ++i) {
+		if (mEvents[i].type == InputEventType::FrameEnd) {
+			return mEvents[i].time;
+		}
+	}
+
+	return mEvents.empty() ? 0.0 : mEvents.back().time;
+}
+
+const InputEvent *InputPlayer::nextFrame(size_t& eventCount) {
+	const size_t firstEvent = mNextEvent;
+
+	while (mNextEvent < mEvents.size() && mEvents[mNextEvent].type != InputEventType::FrameEnd) {
+		++mNextEvent;
+	}
+
+	eventCount = mNextEvent - firstEvent;
+
+	// Skip the marker.
+	if (mNextEvent < mEvents.size()) {
+		++mNextEvent;
+	}
+
+	return mEvents.data() + firstEvent;
+}
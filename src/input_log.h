@@ -0,0 +1,82 @@
+#ifndef H___INPUT_LOG
+#define H___INPUT_LOG
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+// Recording and replay of the GLFW input callbacks, for repeatable editing
+// sessions. Events are grouped into frames as they were handled by the main
+// loop, so a replay reaches the same scene states in the same order.
+//
+// File layout, in native byte order: the magic "KBIL", a uint32 version and
+// the int32 window size, then the events. Each event is a uint8 type and a
+// double time (seconds since the start of the recording), followed by a
+// payload that depends on the type.
+
+enum class InputEventType : uint8_t {
+	CursorPosition,  // x, y
+	MouseButton,     // button, action, mods
+	Key,             // key, scancode, action, mods
+	Character,       // codepoint
+	Scroll,          // x, y
+	FrameBufferSize, // width, height
+	FrameEnd
+};
+
+struct InputEvent {
+	InputEventType type;
+	double time;
+	int32_t values[4];
+	double x;
+	double y;
+};
+
+class InputRecorder {
+public:
+	bool open(const char *path, const int windowWidth, const int windowHeight, const double startTime);
+	void close();
+
+	bool isRecording() const { return mFile != nullptr; }
+
+	// time is on the clock passed to open().
+	void record(const InputEvent& event);
+
+	// Closes the frame if any event was recorded in it.
+	void endFrame(const double time);
+
+private:
+	FILE *mFile = nullptr;
+	double mStartTime = 0.0;
+	bool mIsFrameEmpty = true;
+};
+
+class InputPlayer {
+public:
+	// Reads the whole recording.
+	bool open(const char *path);
+
+	bool isReplaying() const { return mNextEvent < mEvents.size(); }
+
+	int getWindowWidth() const { return mWindowWidth; }
+	int getWindowHeight() const { return mWindowHeight; }
+
+	size_t getFrameCount() const { return mFrameCount; }
+
+	// Recording time at the end of the next frame.
+	double getNextFrameTime() const;
+
+	// The events of the next frame, without its FrameEnd marker.
+	const InputEvent *nextFrame(size_t& eventCount);
+
+private:
+	std::vector<InputEvent> mEvents;
+	size_t mNextEvent = 0;
+	size_t mFrameCount = 0;
+	int mWindowWidth = 0;
+	int mWindowHeight = 0;
+};
+
+#endif // !H___INPUT_LOG
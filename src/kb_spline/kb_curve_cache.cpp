@@ -0,0 +1,159 @@
+#include "kb_curve_cache.h"
+
+#include <algorithm>
+
+void recordChange(ChangeHistory& history, const VertexRange& range) {
+	++history.version;
+	history.ranges[history.version % CHANGE_HISTORY_LENGTH] = range;
+}
+
+void recordFullChange(ChangeHistory& history) {
+	recordChange(history, { 0, 0 });
+	history.lastFullChangeVersion = history.version;
+}
+
+bool getChangesSince(const ChangeHistory& history, const uint64_t version, VertexRange& range) {
+	range = { 0, 0 };
+
+	if (version == history.version) {
+		return true;
+	}
+
+	const bool isKnown =
+		version != 0 &&
+		version < history.version &&
+		version >= history.lastFullChangeVersion &&
+		history.version - version <= CHANGE_HISTORY_LENGTH;
+
+	if (!isKnown) {
+		return false;
+	}
+
+	size_t first = 0;
+	size_t end = 0;
+
+	for (uint64_t changedVersion = version + 1; changedVersion <= history.version; ++changedVersion) {
+		const VertexRange& changedRange = history.ranges[changedVersion % CHANGE_HISTORY_LENGTH];
+
+		if (changedRange.count == 0) {
+			continue;
+		}
+
+		if (first == end) {
+			first = changedRange.first;
+			end = changedRange.first + changedRange.count;
+		} else {
+			first = std::min(first, changedRange.first);
+			end = std::max(end, changedRange.first + changedRange.count);
+		}
+	}
+
+	range = { first, end - first };
+
+	return true;
+}
+
+void invalidateCurveCache(CurveCache& cache) {
+	cache.isAllDirty = true;
+}
+
+void invalidateControlPoint(CurveCache& cache, const size_t controlPointIndex) {
+	// Segment i uses control points i .. i + 3.
+	const size_t firstSegment = controlPointIndex >= 3 ? controlPointIndex - 3 : 0;
+	const size_t endSegment = controlPointIndex + 1;
+
+	if (cache.dirtySegmentBegin == cache.dirtySegmentEnd) {
+		cache.dirtySegmentBegin = firstSegment;
+		cache.dirtySegmentEnd = endSegment;
+	} else {
+		cache.dirtySegmentBegin = std::min(cache.dirtySegmentBegin, firstSegment);
+		cache.dirtySegmentEnd = std::max(cache.dirtySegmentEnd, endSegment);
+	}
+}
+
+void invalidateControlPointsFrom(CurveCache& cache, const size_t controlPointIndex) {
+	invalidateControlPoint(cache, controlPointIndex);
+
+	cache.dirtySegmentEnd = SIZE_MAX;
+}
+
+VertexRange updateCurveCache(
+	CurveCache& cache,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	TessellationThreadPool *threadPool
+) {
+	const size_t stepsPerSegment = basisTable.stepsPerSegment;
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+	const size_t vertexCount = getTessellatedVertexCount(controlPointCount, stepsPerSegment);
+
+	const bool isStateChanged =
+		cache.tension != basisTable.tension ||
+		cache.bias != basisTable.bias ||
+		cache.continuity != basisTable.continuity ||
+		cache.stepsPerSegment != stepsPerSegment ||
+		cache.method != method;
+
+	size_t firstSegment = std::min(cache.dirtySegmentBegin, segmentCount);
+	size_t endSegment = std::min(cache.dirtySegmentEnd, segmentCount);
+
+	if (cache.isAllDirty || isStateChanged) {
+		firstSegment = 0;
+		endSegment = segmentCount;
+	} else if (cache.controlPointCount < controlPointCount) {
+		// Appended points add new segments after the old ones.
+		const size_t oldSegmentCount = getSegmentCount(cache.controlPointCount);
+
+		firstSegment = firstSegment == endSegment ? oldSegmentCount : std::min(firstSegment, oldSegmentCount);
+		endSegment = segmentCount;
+	} else if (cache.controlPointCount > controlPointCount) {
+		// Removed points take their segments along; the new last segment at
+		// least has to close the curve.
+		const size_t lastSegment = segmentCount > 0 ? segmentCount - 1 : 0;
+
+		firstSegment = firstSegment == endSegment ? lastSegment : std::min(firstSegment, lastSegment);
+		endSegment = segmentCount;
+	}
+
+	cache.vertices.resize(vertexCount);
+	cache.dirtySegmentBegin = 0;
+	cache.dirtySegmentEnd = 0;
+	cache.isAllDirty = false;
+	cache.controlPointCount = controlPointCount;
+	cache.tension = basisTable.tension;
+	cache.bias = basisTable.bias;
+	cache.continuity = basisTable.continuity;
+	cache.stepsPerSegment = stepsPerSegment;
+	cache.method = method;
+
+	if (vertexCount == 0 || firstSegment >= endSegment) {
+		return { 0, 0 };
+	}
+
+	const size_t firstVertex = firstSegment * stepsPerSegment;
+	const size_t endVertex = endSegment * stepsPerSegment;
+
+	tessellateSegmentsParallel(
+		threadPool,
+		controlPoints,
+		firstSegment,
+		endSegment - firstSegment,
+		basisTable,
+		method,
+		cache.vertices.data()
+	);
+
+	if (endSegment < segmentCount) {
+		return { firstVertex, endVertex - firstVertex };
+	}
+
+	if (method == TessellationMethod::BasisTable) {
+		closeCurve(controlPoints, controlPointCount, basisTable, cache.vertices.data());
+	} else {
+		closeCurve(controlPoints, controlPointCount, basisTable.coefficientMatrix, stepsPerSegment, cache.vertices.data(), method);
+	}
+
+	return { firstVertex, vertexCount - firstVertex };
+}
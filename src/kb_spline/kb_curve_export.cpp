@@ -0,0 +1,328 @@
+#include "kb_curve_export.h"
+#include "kb_point_file.h"
+#include "kb_trace.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+// Longest number std::to_chars writes for a float, rounded up.
+const size_t MAXIMUM_NUMBER_LENGTH = 32;
+
+// Collects small writes and hands them to the file CURVE_EXPORT_BUFFER_SIZE
+// bytes at a time. A failed write is remembered and reported by flush().
+class BufferedWriter {
+public:
+	explicit BufferedWriter(FILE *output) : mOutput(output), mBuffer(CURVE_EXPORT_BUFFER_SIZE) {}
+
+	void write(const void *data, const size_t size) {
+		if (size > mBuffer.size() - mSize) {
+			flushBuffer();
+
+			// Too large to be worth copying.
+			if (size > mBuffer.size()) {
+				writeFile(data, size);
+				return;
+			}
+		}
+
+		memcpy(mBuffer.data() + mSize, data, size);
+		mSize += size;
+	}
+
+	void writeText(const char *text) {
+		write(text, strlen(text));
+	}
+
+	// Shortest text that reads back as the same float.
+	void writeNumber(const float value) {
+		if (MAXIMUM_NUMBER_LENGTH > mBuffer.size() - mSize) {
+			flushBuffer();
+		}
+
+		char *begin = mBuffer.data() + mSize;
+		const std::to_chars_result result = std::to_chars(begin, begin + MAXIMUM_NUMBER_LENGTH, value);
+
+		mSize += (size_t)(result.ptr - begin);
+	}
+
+	void writePoint(const vec2& point) {
+		writeNumber(point.x);
+		write(" ", 1);
+		writeNumber(point.y);
+	}
+
+	bool flush() {
+		flushBuffer();
+
+		return !mIsFailed && fflush(mOutput) == 0;
+	}
+
+	size_t getByteCount() const { return mByteCount + mSize; }
+
+private:
+	void flushBuffer() {
+		writeFile(mBuffer.data(), mSize);
+		mSize = 0;
+	}
+
+	void writeFile(const void *data, const size_t size) {
+		if (size == 0) {
+			return;
+		}
+
+		if (!mIsFailed && fwrite(data, 1, size, mOutput) != size) {
+			mIsFailed = true;
+		}
+
+		mByteCount += size;
+	}
+
+	FILE *mOutput;
+	std::vector<char> mBuffer;
+	size_t mSize = 0;
+	size_t mByteCount = 0;
+	bool mIsFailed = false;
+};
+
+// Evaluates the curve a batch of whole segments at a time and hands every
+// batch to onVertices; the last batch includes the closing vertex.
+template<typename OnVertices>
+void tessellateBatches(
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	OnVertices onVertices
+) {
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+	const size_t stepsPerSegment = basisTable.stepsPerSegment;
+
+	if (segmentCount == 0 || stepsPerSegment == 0) {
+		return;
+	}
+
+	const size_t batchSegmentCount = std::max<size_t>(CURVE_EXPORT_BATCH_VERTEX_COUNT / stepsPerSegment, 1);
+	std::vector<vec2> vertices(batchSegmentCount * stepsPerSegment + 1);
+
+	for (size_t firstSegment = 0; firstSegment < segmentCount; firstSegment += batchSegmentCount) {
+		const size_t count = std::min(batchSegmentCount, segmentCount - firstSegment);
+		const vec2 *batchControlPoints = controlPoints + firstSegment;
+
+		if (firstSegment + count == segmentCount) {
+			const size_t vertexCount = tessellateCurveParallel(
+				pool,
+				batchControlPoints,
+				count + 3,
+				basisTable,
+				method,
+				vertices.data()
+			);
+
+			onVertices(vertices.data(), vertexCount);
+		} else {
+			tessellateSegmentsParallel(pool, batchControlPoints, 0, count, basisTable, method, vertices.data());
+
+			onVertices(vertices.data(), count * stepsPerSegment);
+		}
+	}
+}
+
+// The Bezier control points of every segment bound the whole curve.
+void calculateBounds(const vec2 *controlPoints, const size_t segmentCount, const mat4& coefficientMatrix, vec2& minimum, vec2& maximum) {
+	minimum = { 0.0f, 0.0f };
+	maximum = { 0.0f, 0.0f };
+
+	for (size_t segmentIndex = 0; segmentIndex < segmentCount; ++segmentIndex) {
+		vec2 bezierPoints[4];
+		calculateBezierControlPoints(calculateSegmentMatrix(segmentIndex, coefficientMatrix, controlPoints), bezierPoints);
+
+		if (segmentIndex == 0) {
+			minimum = maximum = bezierPoints[0];
+		}
+
+		for (const vec2& point : bezierPoints) {
+			minimum = { std::min(minimum.x, point.x), std::min(minimum.y, point.y) };
+			maximum = { std::max(maximum.x, point.x), std::max(maximum.y, point.y) };
+		}
+	}
+}
+
+void writeSvgStart(BufferedWriter& writer, const vec2& minimum, const vec2& maximum) {
+	// Room for the stroke along the edges.
+	const float margin = 1.0f;
+	const vec2 origin = { minimum.x - margin, minimum.y - margin };
+	const vec2 size = { maximum.x - minimum.x + 2.0f * margin, maximum.y - minimum.y + 2.0f * margin };
+
+	writer.writeText("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"");
+	writer.writePoint(origin);
+	writer.writeText(" ");
+	writer.writePoint(size);
+	writer.writeText("\" width=\"");
+	writer.writeNumber(size.x);
+	writer.writeText("\" height=\"");
+	writer.writeNumber(size.y);
+	writer.writeText("\">\n<path fill=\"none\" stroke=\"black\" stroke-width=\"1\" d=\"");
+}
+
+void writeSvgEnd(BufferedWriter& writer) {
+	writer.writeText("\"/>\n</svg>\n");
+}
+
+// Coordinate pairs following the first one of a path repeat its last command,
+// so the path is a single M and the vertices.
+void writeSvgPolyline(
+	BufferedWriter& writer,
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	CurveExportStatistics& statistics
+) {
+	bool isFirstVertex = true;
+
+	tessellateBatches(pool, controlPoints, controlPointCount, basisTable, method, [&](const vec2 *vertices, const size_t vertexCount) {
+		KB_TRACE_SCOPE("Export SVG batch");
+
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+			// One segment per line.
+			if (vertex % basisTable.stepsPerSegment == 0) {
+				writer.writeText(isFirstVertex ? "M" : "\n");
+				isFirstVertex = false;
+			} else {
+				writer.write(" ", 1);
+			}
+
+			writer.writePoint(vertices[vertex]);
+		}
+
+		statistics.pointCount += vertexCount;
+	});
+}
+
+void writeSvgBezier(
+	BufferedWriter& writer,
+	const vec2 *controlPoints,
+	const size_t segmentCount,
+	const mat4& coefficientMatrix,
+	CurveExportStatistics& statistics
+) {
+	KB_TRACE_SCOPE("Export SVG Bezier");
+
+	for (size_t segmentIndex = 0; segmentIndex < segmentCount; ++segmentIndex) {
+		vec2 bezierPoints[4];
+		calculateBezierControlPoints(calculateSegmentMatrix(segmentIndex, coefficientMatrix, controlPoints), bezierPoints);
+
+		if (segmentIndex == 0) {
+			writer.writeText("M");
+			writer.writePoint(bezierPoints[0]);
+			writer.writeText("\nC");
+		} else {
+			writer.write("\n", 1);
+		}
+
+		for (size_t point = 1; point < 4; ++point) {
+			if (point > 1) {
+				writer.write(" ", 1);
+			}
+
+			writer.writePoint(bezierPoints[point]);
+		}
+	}
+
+	statistics.pointCount += segmentCount > 0 ? segmentCount * 3 + 1 : 0;
+}
+
+void writePolylinePointFile(
+	BufferedWriter& writer,
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	CurveExportStatistics& statistics
+) {
+	const PointFileHeader header = makePointFileHeader(
+		getTessellatedVertexCount(controlPointCount, basisTable.stepsPerSegment),
+		basisTable.tension,
+		basisTable.bias,
+		basisTable.continuity
+	);
+
+	writer.write(&header, sizeof(header));
+
+	tessellateBatches(pool, controlPoints, controlPointCount, basisTable, method, [&](const vec2 *vertices, const size_t vertexCount) {
+		writer.write(vertices, vertexCount * sizeof(vec2));
+		statistics.pointCount += vertexCount;
+	});
+}
+
+}
+
+void calculateBezierControlPoints(const mat24& segmentMatrix, vec2 bezierPoints[4]) {
+	// The segment matrix holds the polynomial a*t^3 + b*t^2 + c*t + d column-wise.
+	const vec2 b = { segmentMatrix[0][1], segmentMatrix[1][1] };
+	const vec2 c = { segmentMatrix[0][2], segmentMatrix[1][2] };
+	const vec2 d = { segmentMatrix[0][3], segmentMatrix[1][3] };
+
+	// The end points are evaluated like the tessellated ones.
+	bezierPoints[0] = segmentMatrix * vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	bezierPoints[1] = d + c / 3.0f;
+	bezierPoints[2] = d + (c * 2.0f + b) / 3.0f;
+	bezierPoints[3] = segmentMatrix * vec4(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+bool exportCurve(
+	FILE *output,
+	const CurveExportFormat format,
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	CurveExportStatistics *statistics
+) {
+	KB_TRACE_SCOPE("Export curve");
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	CurveExportStatistics exportStatistics;
+	exportStatistics.segmentCount = getSegmentCount(controlPointCount);
+
+	BufferedWriter writer(output);
+
+	if (format == CurveExportFormat::PointFile) {
+		writePolylinePointFile(writer, pool, controlPoints, controlPointCount, basisTable, method, exportStatistics);
+	} else {
+		vec2 minimum, maximum;
+		calculateBounds(controlPoints, exportStatistics.segmentCount, basisTable.coefficientMatrix, minimum, maximum);
+
+		writeSvgStart(writer, minimum, maximum);
+
+		if (format == CurveExportFormat::SvgBezier) {
+			writeSvgBezier(writer, controlPoints, exportStatistics.segmentCount, basisTable.coefficientMatrix, exportStatistics);
+		} else {
+			writeSvgPolyline(writer, pool, controlPoints, controlPointCount, basisTable, method, exportStatistics);
+		}
+
+		writeSvgEnd(writer);
+	}
+
+	const bool isWritten = writer.flush();
+
+	exportStatistics.byteCount = writer.getByteCount();
+	exportStatistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	if (statistics != nullptr) {
+		*statistics = exportStatistics;
+	}
+
+	return isWritten;
+}
@@ -0,0 +1,178 @@
+#include "kb_parallel.h"
+#include "kb_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <unsupported/Eigen/CXX11/ThreadPool>
+
+namespace {
+
+// Below this a chunk costs less than waking a worker.
+const size_t MINIMUM_VERTICES_PER_CHUNK = 16384;
+
+// A few chunks per thread, so that threads finishing early can take over
+// the work of slower ones.
+const size_t CHUNKS_PER_THREAD = 4;
+
+void tessellateChunk(
+	const vec2 *controlPoints,
+	const size_t firstSegment,
+	const size_t segmentCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	vec2 *output
+) {
+	KB_TRACE_SCOPE("Tessellation chunk");
+
+	if (method == TessellationMethod::BasisTable) {
+		tessellateSegments(controlPoints, firstSegment, segmentCount, basisTable, output);
+	} else {
+		tessellateSegments(
+			controlPoints,
+			firstSegment,
+			segmentCount,
+			basisTable.coefficientMatrix,
+			basisTable.stepsPerSegment,
+			output,
+			method
+		);
+	}
+}
+
+}
+
+struct TessellationThreadPool {
+	size_t threadCount;
+	std::unique_ptr<Eigen::NonBlockingThreadPool> workers;
+};
+
+size_t getHardwareThreadCount() {
+	return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+TessellationThreadPool *createTessellationThreadPool(const size_t threadCount) {
+	TessellationThreadPool *pool = new TessellationThreadPool();
+	pool->threadCount = std::max<size_t>(threadCount, 1);
+
+	if (pool->threadCount > 1) {
+		pool->workers.reset(new Eigen::NonBlockingThreadPool((int)pool->threadCount - 1));
+	}
+
+	return pool;
+}
+
+void destroyTessellationThreadPool(TessellationThreadPool *pool) {
+	// The pool's destructor joins the workers.
+	delete pool;
+}
+
+size_t getThreadCount(const TessellationThreadPool *pool) {
+	return pool != nullptr ? pool->threadCount : 1;
+}
+
+void tessellateSegmentsParallel(
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t firstSegment,
+	const size_t segmentCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	vec2 *output
+) {
+	const size_t stepsPerSegment = std::max<size_t>(basisTable.stepsPerSegment, 1);
+	const size_t threadCount = getThreadCount(pool);
+	const size_t maximumChunkCount = threadCount * CHUNKS_PER_THREAD;
+	const size_t chunkCount = std::min(segmentCount * stepsPerSegment / MINIMUM_VERTICES_PER_CHUNK, maximumChunkCount);
+
+	if (threadCount == 1 || chunkCount <= 1) {
+		tessellateChunk(controlPoints, firstSegment, segmentCount, basisTable, method, output);
+		return;
+	}
+
+	const size_t segmentsPerChunk = (segmentCount + chunkCount - 1) / chunkCount;
+
+	runChunksParallel(pool, chunkCount, [&](const size_t chunk) {
+		const size_t chunkFirst = firstSegment + chunk * segmentsPerChunk;
+		const size_t chunkEnd = std::min(chunkFirst + segmentsPerChunk, firstSegment + segmentCount);
+
+		if (chunkFirst < chunkEnd) {
+			tessellateChunk(controlPoints, chunkFirst, chunkEnd - chunkFirst, basisTable, method, output);
+		}
+	});
+}
+
+void runChunksParallel(TessellationThreadPool *pool, const size_t chunkCount, const std::function<void(size_t)>& runChunk) {
+	const size_t threadCount = getThreadCount(pool);
+
+	if (threadCount == 1 || chunkCount <= 1) {
+		for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+			runChunk(chunk);
+		}
+
+		return;
+	}
+
+	// Chunks are handed out through a shared counter instead of one task each:
+	// a helper keeps taking chunks until none are left.
+	std::atomic<size_t> nextChunk(0);
+
+	auto runChunks = [&]() {
+		for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+			runChunk(chunk);
+		}
+	};
+
+	// The helpers reference this stack frame, so wait until every one of them
+	// has returned, even those that found no chunk left.
+	const size_t helperCount = std::min(threadCount - 1, chunkCount - 1);
+	size_t runningHelperCount = helperCount;
+	std::mutex mutex;
+	std::condition_variable helpersDone;
+
+	for (size_t helper = 0; helper < helperCount; ++helper) {
+		pool->workers->Schedule([&]() {
+			runChunks();
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (--runningHelperCount == 0) {
+				helpersDone.notify_one();
+			}
+		});
+	}
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	helpersDone.wait(lock, [&]() { return runningHelperCount == 0; });
+}
+
+size_t tessellateCurveParallel(
+	TessellationThreadPool *pool,
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method,
+	vec2 *output
+) {
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+
+	if (basisTable.stepsPerSegment == 0) {
+		return 0;
+	}
+
+	tessellateSegmentsParallel(pool, controlPoints, 0, segmentCount, basisTable, method, output);
+
+	if (method == TessellationMethod::BasisTable) {
+		closeCurve(controlPoints, controlPointCount, basisTable, output);
+	} else {
+		closeCurve(controlPoints, controlPointCount, basisTable.coefficientMatrix, basisTable.stepsPerSegment, output, method);
+	}
+
+	return getTessellatedVertexCount(controlPointCount, basisTable.stepsPerSegment);
+}
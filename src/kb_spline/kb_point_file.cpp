@@ -0,0 +1,180 @@
+#include "kb_point_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char POINT_FILE_MAGIC[8] = { 'K', 'B', 'P', 'O', 'I', 'N', 'T', 'S' };
+
+// The whole file, or nullptr. The file handle is not needed after mapping.
+const void *mapFile(const char *path, size_t& size) {
+#if defined(_WIN32)
+	HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(fileHandle);
+		return nullptr;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(fileHandle);
+
+	if (mappingHandle == nullptr) {
+		return nullptr;
+	}
+
+	const void *mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mappingHandle);
+
+	size = (size_t)fileSize.QuadPart;
+
+	return mapping;
+#else
+	const int fileDescriptor = open(path, O_RDONLY);
+	if (fileDescriptor < 0) {
+		return nullptr;
+	}
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0) {
+		close(fileDescriptor);
+		return nullptr;
+	}
+
+	void *mapping = mmap(nullptr, (size_t)fileStatus.st_size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+
+	if (mapping == MAP_FAILED) {
+		return nullptr;
+	}
+
+	size = (size_t)fileStatus.st_size;
+
+	return mapping;
+#endif
+}
+
+void unmapFile(const void *mapping, const size_t size) {
+#if defined(_WIN32)
+	UnmapViewOfFile(mapping);
+#else
+	munmap(const_cast<void *>(mapping), size);
+#endif
+}
+
+bool isValidHeader(const PointFileHeader& header, const size_t fileSize) {
+	if (memcmp(header.magic, POINT_FILE_MAGIC, sizeof(POINT_FILE_MAGIC)) != 0 || header.version != POINT_FILE_VERSION) {
+		return false;
+	}
+
+	if (header.dataOffset < sizeof(PointFileHeader) || header.dataOffset % POINT_FILE_ALIGNMENT != 0 || header.dataOffset > fileSize) {
+		return false;
+	}
+
+	// Also rejects counts whose byte size would overflow.
+	return header.pointCount <= (fileSize - header.dataOffset) / sizeof(vec2);
+}
+
+}
+
+bool openPointFile(MappedPointFile& file, const char *path) {
+	closePointFile(file);
+
+	size_t mappingSize = 0;
+	const void *mapping = mapFile(path, mappingSize);
+
+	if (mapping == nullptr) {
+		return false;
+	}
+
+	if (mappingSize < sizeof(PointFileHeader)) {
+		unmapFile(mapping, mappingSize);
+		return false;
+	}
+
+	const PointFileHeader& header = *(const PointFileHeader *)mapping;
+
+	if (!isValidHeader(header, mappingSize)) {
+		unmapFile(mapping, mappingSize);
+		return false;
+	}
+
+	file.points = (const vec2 *)((const char *)mapping + header.dataOffset);
+	file.pointCount = (size_t)header.pointCount;
+	file.tension = header.tension;
+	file.bias = header.bias;
+	file.continuity = header.continuity;
+	file.mapping = mapping;
+	file.mappingSize = mappingSize;
+
+	return true;
+}
+
+void closePointFile(MappedPointFile& file) {
+	if (file.mapping != nullptr) {
+		unmapFile(file.mapping, file.mappingSize);
+	}
+
+	file = MappedPointFile();
+}
+
+PointFileHeader makePointFileHeader(
+	const size_t pointCount,
+	const float tension,
+	const float bias,
+	const float continuity
+) {
+	PointFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, POINT_FILE_MAGIC, sizeof(POINT_FILE_MAGIC));
+	header.version = POINT_FILE_VERSION;
+	header.dataOffset = (uint32_t)sizeof(PointFileHeader);
+	header.pointCount = (uint64_t)pointCount;
+	header.tension = tension;
+	header.bias = bias;
+	header.continuity = continuity;
+
+	return header;
+}
+
+bool writePointFile(
+	const char *path,
+	const vec2 *points,
+	const size_t pointCount,
+	const float tension,
+	const float bias,
+	const float continuity
+) {
+	FILE *output = fopen(path, "wb");
+
+	if (output == nullptr) {
+		return false;
+	}
+
+	const PointFileHeader header = makePointFileHeader(pointCount, tension, bias, continuity);
+
+	bool isWritten = fwrite(&header, sizeof(header), 1, output) == 1;
+
+	if (isWritten && pointCount > 0) {
+		isWritten = fwrite(points, sizeof(vec2), pointCount, output) == pointCount;
+	}
+
+	// A failed flush on close is a failed write as well.
+	return fclose(output) == 0 && isWritten;
+}
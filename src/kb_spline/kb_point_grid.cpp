@@ -0,0 +1,138 @@
+#include "kb_point_grid.h"
+
+#include <algorithm>
+
+namespace {
+
+int32_t getCellCoordinate(const float coordinate, const float cellSize) {
+	return (int32_t)floorf(coordinate / cellSize);
+}
+
+uint64_t getCellKey(const int32_t cellX, const int32_t cellY) {
+	return ((uint64_t)(uint32_t)cellX << 32) | (uint64_t)(uint32_t)cellY;
+}
+
+uint64_t getCellKey(const PointGrid& grid, const vec2 position) {
+	return getCellKey(getCellCoordinate(position.x, grid.cellSize), getCellCoordinate(position.y, grid.cellSize));
+}
+
+void removeGridIndex(PointGrid& grid, const uint64_t key, const size_t pointIndex) {
+	const auto cell = grid.cells.find(key);
+
+	if (cell == grid.cells.end()) {
+		return;
+	}
+
+	std::vector<uint32_t>& indices = cell->second;
+	const auto index = std::find(indices.begin(), indices.end(), (uint32_t)pointIndex);
+
+	if (index != indices.end()) {
+		*index = indices.back();
+		indices.pop_back();
+	}
+
+	if (indices.empty()) {
+		grid.cells.erase(cell);
+	}
+}
+
+// The point at position moved from oldIndex to newIndex in the point array.
+void renumberGridPoint(PointGrid& grid, const vec2 position, const size_t oldIndex, const size_t newIndex) {
+	const auto cell = grid.cells.find(getCellKey(grid, position));
+
+	if (cell == grid.cells.end()) {
+		return;
+	}
+
+	std::vector<uint32_t>& indices = cell->second;
+	const auto index = std::find(indices.begin(), indices.end(), (uint32_t)oldIndex);
+
+	if (index != indices.end()) {
+		*index = (uint32_t)newIndex;
+	}
+}
+
+}
+
+void buildPointGrid(PointGrid& grid, const float cellSize, const vec2 *points, const size_t pointCount) {
+	grid.cellSize = cellSize;
+	grid.cells.clear();
+
+	for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex) {
+		insertGridPoint(grid, pointIndex, points[pointIndex]);
+	}
+}
+
+void insertGridPoint(PointGrid& grid, const size_t pointIndex, const vec2 position) {
+	grid.cells[getCellKey(grid, position)].push_back((uint32_t)pointIndex);
+}
+
+void moveGridPoint(PointGrid& grid, const size_t pointIndex, const vec2 oldPosition, const vec2 newPosition) {
+	const uint64_t oldKey = getCellKey(grid, oldPosition);
+	const uint64_t newKey = getCellKey(grid, newPosition);
+
+	if (oldKey == newKey) {
+		return;
+	}
+
+	removeGridIndex(grid, oldKey, pointIndex);
+	grid.cells[newKey].push_back((uint32_t)pointIndex);
+}
+
+void insertShiftedGridPoint(PointGrid& grid, const vec2 *points, const size_t pointCount, const size_t pointIndex) {
+	// From the back, so that a renumbered index never meets one still to be
+	// renumbered.
+	for (size_t index = pointCount - 1; index > pointIndex; --index) {
+		renumberGridPoint(grid, points[index], index - 1, index);
+	}
+
+	insertGridPoint(grid, pointIndex, points[pointIndex]);
+}
+
+void eraseShiftedGridPoint(
+	PointGrid& grid,
+	const vec2 *points,
+	const size_t pointCount,
+	const size_t pointIndex,
+	const vec2 erasedPosition
+) {
+	removeGridIndex(grid, getCellKey(grid, erasedPosition), pointIndex);
+
+	for (size_t index = pointIndex; index < pointCount; ++index) {
+		renumberGridPoint(grid, points[index], index + 1, index);
+	}
+}
+
+size_t findGridPoint(const PointGrid& grid, const vec2 *points, const vec2 position, const float maximumDistance2) {
+	const int32_t cellX = getCellCoordinate(position.x, grid.cellSize);
+	const int32_t cellY = getCellCoordinate(position.y, grid.cellSize);
+
+	size_t foundIndex = NO_GRID_POINT;
+	float foundDistance2 = maximumDistance2;
+
+	for (int32_t offsetY = -1; offsetY <= 1; ++offsetY) {
+		for (int32_t offsetX = -1; offsetX <= 1; ++offsetX) {
+			const auto cell = grid.cells.find(getCellKey(cellX + offsetX, cellY + offsetY));
+
+			if (cell == grid.cells.end()) {
+				continue;
+			}
+
+			for (const uint32_t pointIndex : cell->second) {
+				const float distance2 = dist2(position, points[pointIndex]);
+
+				// Cells keep no order, so ties go to the lower index explicitly.
+				const bool isCloser =
+					distance2 < foundDistance2 ||
+					(distance2 == foundDistance2 && pointIndex < foundIndex);
+
+				if (isCloser) {
+					foundIndex = pointIndex;
+					foundDistance2 = distance2;
+				}
+			}
+		}
+	}
+
+	return foundIndex;
+}
@@ -0,0 +1,358 @@
+#include "kb_point_import.h"
+#include "kb_trace.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+
+namespace {
+
+// Below this a chunk costs less than waking a worker.
+const size_t MINIMUM_CHUNK_SIZE = 256 * 1024;
+
+// A few chunks per thread, as lines differ in length.
+const size_t CHUNKS_PER_THREAD = 4;
+
+bool isBlank(const char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char *skipBlanks(const char *position, const char *end) {
+	while (position < end && isBlank(*position)) {
+		++position;
+	}
+
+	return position;
+}
+
+// The end of the number, or nullptr if there is none at position.
+const char *parseNumber(const char *position, const char *end, float& value) {
+	// std::from_chars does not accept an explicit plus sign.
+	if (position < end && *position == '+') {
+		++position;
+	}
+
+	const std::from_chars_result result = std::from_chars(position, end, value);
+
+	return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+// false if the line is neither a point nor skipped; isPoint tells whether
+// point was written.
+bool parseLine(const char *position, const char *end, vec2& point, bool& isPoint) {
+	isPoint = false;
+	position = skipBlanks(position, end);
+
+	if (position == end || *position == '#') {
+		return true;
+	}
+
+	const char *numberEnd = parseNumber(position, end, point.x);
+	if (numberEnd == nullptr) {
+		return false;
+	}
+
+	position = skipBlanks(numberEnd, end);
+	if (position < end && (*position == ',' || *position == ';')) {
+		position = skipBlanks(position + 1, end);
+	}
+
+	// The numbers need a separator between them.
+	if (position == numberEnd) {
+		return false;
+	}
+
+	numberEnd = parseNumber(position, end, point.y);
+	if (numberEnd == nullptr) {
+		return false;
+	}
+
+	if (numberEnd < end && !isBlank(*numberEnd) && *numberEnd != ',' && *numberEnd != ';') {
+		return false;
+	}
+
+	isPoint = true;
+
+	return true;
+}
+
+// Every line holds at most one point.
+size_t countLines(const char *begin, const char *end) {
+	size_t lineCount = 0;
+
+	while (begin < end) {
+		const char *lineEnd = (const char *)memchr(begin, '\n', (size_t)(end - begin));
+
+		++lineCount;
+
+		if (lineEnd == nullptr) {
+			break;
+		}
+
+		begin = lineEnd + 1;
+	}
+
+	return lineCount;
+}
+
+// Writes the points to output, which has room for one per line. Returns the
+// number of points written.
+size_t parseLines(const char *begin, const char *end, vec2 *output, size_t& rejectedLineCount) {
+	KB_TRACE_SCOPE("Point import chunk");
+
+	size_t pointCount = 0;
+	rejectedLineCount = 0;
+
+	while (begin < end) {
+		const char *lineEnd = (const char *)memchr(begin, '\n', (size_t)(end - begin));
+
+		if (lineEnd == nullptr) {
+			lineEnd = end;
+		}
+
+		bool isPoint;
+
+		if (!parseLine(begin, lineEnd, output[pointCount], isPoint)) {
+			++rejectedLineCount;
+		} else if (isPoint) {
+			++pointCount;
+		}
+
+		begin = lineEnd + 1;
+	}
+
+	return pointCount;
+}
+
+// Parses whole lines and appends the points to points, in input order. Every
+// chunk is parsed straight into its place in points, at the sum of the line
+// counts of the chunks before it; the gaps left by lines without a point are
+// closed afterwards.
+void parseBlock(
+	TessellationThreadPool *pool,
+	const char *begin,
+	const char *end,
+	std::vector<vec2>& points,
+	PointImportStatistics& statistics
+) {
+	const size_t size = (size_t)(end - begin);
+	const size_t chunkCount = std::max<size_t>(
+		std::min(size / MINIMUM_CHUNK_SIZE, getThreadCount(pool) * CHUNKS_PER_THREAD),
+		1
+	);
+
+	// Every chunk boundary is moved forward to the start of the next line.
+	std::vector<const char *> boundaries(chunkCount + 1);
+	boundaries[0] = begin;
+	boundaries[chunkCount] = end;
+
+	for (size_t chunk = 1; chunk < chunkCount; ++chunk) {
+		const char *position = std::max(begin + size * chunk / chunkCount, boundaries[chunk - 1]);
+		const char *lineEnd = (const char *)memchr(position, '\n', (size_t)(end - position));
+
+		boundaries[chunk] = lineEnd != nullptr ? lineEnd + 1 : end;
+	}
+
+	std::vector<size_t> offsets(chunkCount + 1);
+	offsets[0] = points.size();
+
+	runChunksParallel(pool, chunkCount, [&](const size_t chunk) {
+		offsets[chunk + 1] = countLines(boundaries[chunk], boundaries[chunk + 1]);
+	});
+
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		offsets[chunk + 1] += offsets[chunk];
+	}
+
+	points.resize(offsets[chunkCount]);
+
+	std::vector<size_t> pointCounts(chunkCount);
+	std::vector<size_t> rejectedLineCounts(chunkCount);
+
+	runChunksParallel(pool, chunkCount, [&](const size_t chunk) {
+		pointCounts[chunk] = parseLines(
+			boundaries[chunk],
+			boundaries[chunk + 1],
+			points.data() + offsets[chunk],
+			rejectedLineCounts[chunk]
+		);
+	});
+
+	size_t pointEnd = offsets[0];
+
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		if (pointEnd != offsets[chunk]) {
+			memmove(points.data() + pointEnd, points.data() + offsets[chunk], pointCounts[chunk] * sizeof(vec2));
+		}
+
+		pointEnd += pointCounts[chunk];
+		statistics.pointCount += pointCounts[chunk];
+		statistics.rejectedLineCount += rejectedLineCounts[chunk];
+	}
+
+	points.resize(pointEnd);
+}
+
+// Counts the lines from the current position to the end of the input, which
+// holds the number of points parsed from it at most. Leaves the input at its
+// end.
+size_t countRemainingLines(FILE *input, TessellationThreadPool *pool, std::vector<char>& buffer) {
+	KB_TRACE_SCOPE("Count import lines");
+
+	size_t lineCount = 0;
+	char lastCharacter = '\n';
+	size_t readSize;
+
+	while ((readSize = fread(buffer.data(), 1, buffer.size(), input)) > 0) {
+		const size_t chunkCount = std::max<size_t>(
+			std::min(readSize / MINIMUM_CHUNK_SIZE, getThreadCount(pool) * CHUNKS_PER_THREAD),
+			1
+		);
+
+		std::vector<size_t> newlineCounts(chunkCount);
+
+		runChunksParallel(pool, chunkCount, [&](const size_t chunk) {
+			const char *chunkBegin = buffer.data() + readSize * chunk / chunkCount;
+			const char *chunkEnd = buffer.data() + readSize * (chunk + 1) / chunkCount;
+
+			newlineCounts[chunk] = (size_t)std::count(chunkBegin, chunkEnd, '\n');
+		});
+
+		for (const size_t newlineCount : newlineCounts) {
+			lineCount += newlineCount;
+		}
+
+		lastCharacter = buffer[readSize - 1];
+	}
+
+	// The last line may lack its newline.
+	return lastCharacter != '\n' ? lineCount + 1 : lineCount;
+}
+
+// Appends the points of every block to points, and calls onBlock after each
+// one. The incomplete last line of a block is carried over to the next one; a
+// line longer than a whole block is rejected.
+//
+// With isReserving, a seekable input is read twice: the lines are counted
+// first, so points is reserved once and never reallocated. A pipe cannot be
+// read twice, points grows as the blocks arrive then.
+bool readBlocks(
+	FILE *input,
+	TessellationThreadPool *pool,
+	std::vector<vec2>& points,
+	PointImportStatistics& statistics,
+	const bool isReserving,
+	const std::function<void()>& onBlock
+) {
+	const auto startTime = std::chrono::steady_clock::now();
+
+	statistics = PointImportStatistics();
+
+	std::vector<char> buffer(POINT_IMPORT_BLOCK_SIZE);
+
+	// Fails on a pipe.
+	const long startPosition = isReserving ? ftell(input) : -1;
+
+	if (startPosition >= 0) {
+		const size_t lineCount = countRemainingLines(input, pool, buffer);
+
+		if (ferror(input) != 0 || fseek(input, startPosition, SEEK_SET) != 0) {
+			return false;
+		}
+
+		points.reserve(points.size() + lineCount);
+	}
+	size_t carriedSize = 0;
+	bool isSkippingLine = false;
+
+	for (;;) {
+		const size_t requestedSize = buffer.size() - carriedSize;
+		const size_t readSize = fread(buffer.data() + carriedSize, 1, requestedSize, input);
+		statistics.byteCount += readSize;
+
+		// fread only returns less than requested at the end of the input.
+		const bool isLastBlock = readSize < requestedSize;
+
+		const char *begin = buffer.data();
+		const char *end = begin + carriedSize + readSize;
+		const char *parseEnd = end;
+
+		if (!isLastBlock) {
+			const char *position = end;
+			while (position > begin && position[-1] != '\n') {
+				--position;
+			}
+
+			if (position == begin) {
+				// The whole block is a single line.
+				if (!isSkippingLine) {
+					++statistics.rejectedLineCount;
+					isSkippingLine = true;
+				}
+
+				carriedSize = 0;
+				continue;
+			}
+
+			parseEnd = position;
+		}
+
+		if (isSkippingLine) {
+			const char *lineEnd = (const char *)memchr(begin, '\n', (size_t)(parseEnd - begin));
+
+			begin = lineEnd != nullptr ? lineEnd + 1 : parseEnd;
+			isSkippingLine = false;
+		}
+
+		parseBlock(pool, begin, parseEnd, points, statistics);
+		onBlock();
+
+		if (isLastBlock) {
+			break;
+		}
+
+		carriedSize = (size_t)(end - parseEnd);
+		memmove(buffer.data(), parseEnd, carriedSize);
+	}
+
+	statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	return ferror(input) == 0;
+}
+
+}
+
+double getImportThroughput(const PointImportStatistics& statistics) {
+	return statistics.seconds > 0.0 ? (double)statistics.byteCount / 1e6 / statistics.seconds : 0.0;
+}
+
+bool importPointText(
+	FILE *input,
+	TessellationThreadPool *pool,
+	std::vector<vec2>& points,
+	PointImportStatistics& statistics
+) {
+	points.clear();
+
+	return readBlocks(input, pool, points, statistics, true, []() {});
+}
+
+bool streamPointText(
+	FILE *input,
+	TessellationThreadPool *pool,
+	const std::function<void(const vec2 *points, size_t pointCount)>& onPoints,
+	PointImportStatistics& statistics
+) {
+	// Holds one block of points, emptied after every block.
+	std::vector<vec2> blockPoints;
+
+	return readBlocks(input, pool, blockPoints, statistics, false, [&]() {
+		if (!blockPoints.empty()) {
+			onPoints(blockPoints.data(), blockPoints.size());
+		}
+
+		blockPoints.clear();
+	});
+}
@@ -0,0 +1,241 @@
+#include "kb_sliced_tessellator.h"
+#include "kb_trace.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <coro.h>
+
+namespace {
+
+// The clock is checked after every batch of this many segments.
+const size_t SEGMENTS_PER_BATCH = 64;
+
+// In units of sizeof(void *). Tessellation needs only a few kilobytes.
+const unsigned int COROUTINE_STACK_SIZE = 16384;
+
+double getTime() {
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+	return std::chrono::duration<double>(now).count();
+}
+
+}
+
+struct SlicedTessellator::Coroutine {
+	coro_context caller;
+	coro_context tessellation;
+	coro_stack stack;
+};
+
+SlicedTessellator::SlicedTessellator() {
+}
+
+SlicedTessellator::~SlicedTessellator() {
+	free();
+}
+
+bool SlicedTessellator::init() {
+	free();
+
+	std::unique_ptr<Coroutine> coroutine(new Coroutine());
+
+	if (!coro_stack_alloc(&coroutine->stack, COROUTINE_STACK_SIZE)) {
+		return false;
+	}
+
+	coro_create(&coroutine->caller, nullptr, nullptr, nullptr, 0);
+	coro_create(&coroutine->tessellation, &SlicedTessellator::run, this, coroutine->stack.sptr, coroutine->stack.ssze);
+
+	mCoroutine = std::move(coroutine);
+
+	return true;
+}
+
+void SlicedTessellator::free() {
+	if (!mCoroutine) {
+		return;
+	}
+
+	// A suspended coroutine only has trivially destructible locals, so its
+	// stack can simply be dropped.
+	coro_destroy(&mCoroutine->tessellation);
+	coro_destroy(&mCoroutine->caller);
+	coro_stack_free(&mCoroutine->stack);
+
+	mCoroutine.reset();
+}
+
+void SlicedTessellator::start(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	const TessellationMethod method
+) {
+	const size_t oldControlPointCount = mControlPoints.size();
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+
+	const bool isStateChanged =
+		mBasisTable.tension != basisTable.tension ||
+		mBasisTable.bias != basisTable.bias ||
+		mBasisTable.continuity != basisTable.continuity ||
+		mBasisTable.stepsPerSegment != basisTable.stepsPerSegment ||
+		mMethod != method;
+
+	size_t firstSegment = 0;
+	size_t endSegment = segmentCount;
+
+	if (!isStateChanged) {
+		const size_t commonCount = std::min(controlPointCount, oldControlPointCount);
+
+		size_t firstChanged = 0;
+		while (firstChanged < commonCount && controlPoints[firstChanged] == mControlPoints[firstChanged]) {
+			++firstChanged;
+		}
+
+		if (controlPointCount == oldControlPointCount) {
+			if (firstChanged == commonCount) {
+				return;
+			}
+
+			size_t lastChanged = commonCount - 1;
+			while (controlPoints[lastChanged] == mControlPoints[lastChanged]) {
+				--lastChanged;
+			}
+
+			// Segment i uses control points i .. i + 3.
+			endSegment = std::min(lastChanged + 1, segmentCount);
+		}
+
+		firstSegment = firstChanged >= 3 ? firstChanged - 3 : 0;
+	}
+
+	// Segments left over from the previous start() still have to be done.
+	if (mDirtySegmentBegin < mDirtySegmentEnd) {
+		firstSegment = std::min(firstSegment, mDirtySegmentBegin);
+		endSegment = std::max(endSegment, mDirtySegmentEnd);
+	}
+
+	endSegment = std::min(endSegment, segmentCount);
+	firstSegment = std::min(firstSegment, endSegment);
+
+	mControlPoints.assign(controlPoints, controlPoints + controlPointCount);
+	mBasisTable = basisTable;
+	mMethod = method;
+
+	const size_t vertexCount = getTessellatedVertexCount(controlPointCount, basisTable.stepsPerSegment);
+
+	mVertices.resize(vertexCount);
+	mValidVertexCount = std::min(mValidVertexCount, vertexCount);
+
+	mDirtySegmentBegin = firstSegment;
+	mDirtySegmentEnd = endSegment;
+	mIsCloseNeeded = vertexCount > 0;
+}
+
+bool SlicedTessellator::resume(const double timeBudget) {
+	if (!mCoroutine || isFinished()) {
+		return isFinished();
+	}
+
+	KB_TRACE_SCOPE("Tessellation slice");
+
+	mDeadline = getTime() + timeBudget;
+
+	coro_transfer(&mCoroutine->caller, &mCoroutine->tessellation);
+
+	return isFinished();
+}
+
+bool SlicedTessellator::isFinished() const {
+	return mDirtySegmentBegin >= mDirtySegmentEnd && !mIsCloseNeeded;
+}
+
+const vec2 *SlicedTessellator::getVertices() const {
+	return mVertices.data();
+}
+
+size_t SlicedTessellator::getVertexCount() const {
+	return mValidVertexCount;
+}
+
+VertexRange SlicedTessellator::takeChangedRange() {
+	const VertexRange changedRange = mChangedRange;
+
+	mChangedRange = { 0, 0 };
+
+	return changedRange;
+}
+
+void SlicedTessellator::run(void *argument) {
+	static_cast<SlicedTessellator *>(argument)->tessellate();
+}
+
+void SlicedTessellator::tessellate() {
+	// Never returns: libcoro coroutines must not fall off their function.
+	for (;;) {
+		// The range is re-read after every yield, start() may have changed it.
+		while (mDirtySegmentBegin < mDirtySegmentEnd) {
+			const size_t firstSegment = mDirtySegmentBegin;
+			const size_t segmentCount = std::min(SEGMENTS_PER_BATCH, mDirtySegmentEnd - firstSegment);
+			const size_t stepsPerSegment = mBasisTable.stepsPerSegment;
+
+			if (mMethod == TessellationMethod::BasisTable) {
+				tessellateSegments(mControlPoints.data(), firstSegment, segmentCount, mBasisTable, mVertices.data());
+			} else {
+				tessellateSegments(
+					mControlPoints.data(),
+					firstSegment,
+					segmentCount,
+					mBasisTable.coefficientMatrix,
+					stepsPerSegment,
+					mVertices.data(),
+					mMethod
+				);
+			}
+
+			mDirtySegmentBegin = firstSegment + segmentCount;
+
+			markChanged(firstSegment * stepsPerSegment, segmentCount * stepsPerSegment);
+			mValidVertexCount = std::max(mValidVertexCount, mDirtySegmentBegin * stepsPerSegment);
+
+			if (getTime() >= mDeadline) {
+				coro_transfer(&mCoroutine->tessellation, &mCoroutine->caller);
+			}
+		}
+
+		if (mIsCloseNeeded) {
+			if (mMethod == TessellationMethod::BasisTable) {
+				closeCurve(mControlPoints.data(), mControlPoints.size(), mBasisTable, mVertices.data());
+			} else {
+				closeCurve(
+					mControlPoints.data(),
+					mControlPoints.size(),
+					mBasisTable.coefficientMatrix,
+					mBasisTable.stepsPerSegment,
+					mVertices.data(),
+					mMethod
+				);
+			}
+
+			mIsCloseNeeded = false;
+
+			markChanged(mVertices.size() - 1, 1);
+			mValidVertexCount = mVertices.size();
+		}
+
+		coro_transfer(&mCoroutine->tessellation, &mCoroutine->caller);
+	}
+}
+
+void SlicedTessellator::markChanged(const size_t firstVertex, const size_t vertexCount) {
+	if (mChangedRange.count == 0) {
+		mChangedRange = { firstVertex, vertexCount };
+		return;
+	}
+
+	const size_t first = std::min(mChangedRange.first, firstVertex);
+	const size_t end = std::max(mChangedRange.first + mChangedRange.count, firstVertex + vertexCount);
+
+	mChangedRange = { first, end - first };
+}
@@ -0,0 +1,418 @@
+#include "kb_spline.h"
+#include "kb_spline_simd.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+mat4 calculateCoefficientMatrix(const float tension, const float bias, const float continuity) {
+	const float s = 0.5f * (1.0f - tension);
+	const float q1 = s * (1.0f + bias) * (1.0f - continuity);
+	const float q2 = s * (1.0f - bias) * (1.0f + continuity);
+	const float q3 = s * (1.0f + bias) * (1.0f + continuity);
+	const float q4 = s * (1.0f - bias) * (1.0f - continuity);
+
+	return {
+		{ -q1, 2.0f * q1, -q1, 0 },
+		{ q1 - q2 - q3 + 2.0f, q3 - (2.0f * q1) + (2.0f * q2) - 3.0f, q1 - q2, 1.0f },
+		{ q2 + q3 - q4 - 2.0f, q4 - q3 - (2.0f * q2) + 3.0f, q2, 0 },
+		{ q4, -q4, 0, 0}
+	};
+}
+
+size_t getSegmentCount(const size_t controlPointCount) {
+	if (controlPointCount < MINIMUM_NUMBER_OF_CONTROL_POINTS) {
+		return 0;
+	}
+
+	return controlPointCount - 3;
+}
+
+size_t getTessellatedVertexCount(const size_t controlPointCount, const size_t stepsPerSegment) {
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+
+	if (segmentCount == 0 || stepsPerSegment == 0) {
+		return 0;
+	}
+
+	return segmentCount * stepsPerSegment + 1;
+}
+
+mat24 calculateSegmentMatrix(const size_t segmentIndex, const mat4& coefficientMatrix, const vec2 *controlPoints) {
+	const mat24 geometry = {
+		controlPoints[segmentIndex + 0],
+		controlPoints[segmentIndex + 1],
+		controlPoints[segmentIndex + 2],
+		controlPoints[segmentIndex + 3]
+	};
+
+	return geometry * coefficientMatrix;
+}
+
+void tessellateSegment(const mat24& segmentMatrix, const size_t stepsPerSegment, vec2 *output) {
+	const float parameterDelta = 1.0f / (float)stepsPerSegment;
+
+	for (size_t step = 0; step < stepsPerSegment; ++step) {
+		const float t = (float)step * parameterDelta;
+		const vec4 parameterVector = { t * t * t, t * t, t, 1.0f };
+
+		output[step] = segmentMatrix * parameterVector;
+	}
+}
+
+void tessellateSegmentForwardDifferencing(const mat24& segmentMatrix, const size_t stepsPerSegment, vec2 *output) {
+	// The segment matrix holds the polynomial a*t^3 + b*t^2 + c*t + d column-wise.
+	const vec2 a = { segmentMatrix[0][0], segmentMatrix[1][0] };
+	const vec2 b = { segmentMatrix[0][1], segmentMatrix[1][1] };
+	const vec2 c = { segmentMatrix[0][2], segmentMatrix[1][2] };
+	const vec2 d = { segmentMatrix[0][3], segmentMatrix[1][3] };
+
+	const float h = 1.0f / (float)stepsPerSegment;
+	const float h2 = h * h;
+	const float h3 = h2 * h;
+
+	vec2 point = d;
+	vec2 firstDifference = a * h3 + b * h2 + c * h;
+	vec2 secondDifference = a * (6.0f * h3) + b * (2.0f * h2);
+	const vec2 thirdDifference = a * (6.0f * h3);
+
+	for (size_t step = 0; step < stepsPerSegment; ++step) {
+		output[step] = point;
+
+		point += firstDifference;
+		firstDifference += secondDifference;
+		secondDifference += thirdDifference;
+	}
+}
+
+namespace {
+
+void fillBasisWeights(BasisTable& table, const size_t stepsPerSegment) {
+	const float parameterDelta = 1.0f / (float)stepsPerSegment;
+
+	table.stepsPerSegment = stepsPerSegment;
+	table.weights.resize(stepsPerSegment + 1);
+
+	for (size_t step = 0; step <= stepsPerSegment; ++step) {
+		const float t = step == stepsPerSegment ? 1.0f : (float)step * parameterDelta;
+		const vec4 parameterVector = { t * t * t, t * t, t, 1.0f };
+
+		table.weights[step] = table.coefficientMatrix * parameterVector;
+	}
+}
+
+}
+
+bool updateBasisTable(
+	BasisTable& table,
+	const float tension,
+	const float bias,
+	const float continuity,
+	const size_t stepsPerSegment
+) {
+	const bool isUpToDate =
+		!table.weights.empty() &&
+		table.tension == tension &&
+		table.bias == bias &&
+		table.continuity == continuity &&
+		table.stepsPerSegment == stepsPerSegment;
+
+	if (isUpToDate) {
+		return false;
+	}
+
+	table.tension = tension;
+	table.bias = bias;
+	table.continuity = continuity;
+	table.coefficientMatrix = calculateCoefficientMatrix(tension, bias, continuity);
+
+	fillBasisWeights(table, stepsPerSegment);
+
+	return true;
+}
+
+void tessellateSegments(
+	const vec2 *controlPoints,
+	const size_t firstSegment,
+	const size_t segmentCount,
+	const BasisTable& basisTable,
+	vec2 *output
+) {
+	const size_t stepsPerSegment = basisTable.stepsPerSegment;
+	const vec4 *weights = basisTable.weights.data();
+
+	for (size_t segmentIndex = firstSegment; segmentIndex < firstSegment + segmentCount; ++segmentIndex) {
+		const vec2 p0 = controlPoints[segmentIndex + 0];
+		const vec2 p1 = controlPoints[segmentIndex + 1];
+		const vec2 p2 = controlPoints[segmentIndex + 2];
+		const vec2 p3 = controlPoints[segmentIndex + 3];
+
+		vec2 *segmentOutput = output + segmentIndex * stepsPerSegment;
+
+		for (size_t step = 0; step < stepsPerSegment; ++step) {
+			const vec4 w = weights[step];
+
+			segmentOutput[step] = {
+				p0.x * w.x + p1.x * w.y + p2.x * w.z + p3.x * w.w,
+				p0.y * w.x + p1.y * w.y + p2.y * w.z + p3.y * w.w
+			};
+		}
+	}
+}
+
+void tessellateSegments(
+	const vec2 *controlPoints,
+	const size_t firstSegment,
+	const size_t segmentCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	vec2 *output,
+	const TessellationMethod method
+) {
+	// The table is rebuilt on every call here; the callers in this library
+	// pass their table to the BasisTable overload instead.
+	assert(method != TessellationMethod::BasisTable && "use the BasisTable overload");
+
+	if (segmentCount == 0 || stepsPerSegment == 0) {
+		return;
+	}
+
+	if (method == TessellationMethod::BasisTable) {
+		BasisTable basisTable;
+		basisTable.coefficientMatrix = coefficientMatrix;
+		fillBasisWeights(basisTable, stepsPerSegment);
+
+		tessellateSegments(controlPoints, firstSegment, segmentCount, basisTable, output);
+	} else if (method == TessellationMethod::Simd) {
+		const CurveSource source = { controlPoints + firstSegment, nullptr, nullptr };
+		const CurveTarget target = { output + firstSegment * stepsPerSegment, nullptr, nullptr };
+
+		tessellateSegmentsSimd(source, segmentCount, coefficientMatrix, stepsPerSegment, target, getSupportedSimdLevel());
+	} else {
+		for (size_t segmentIndex = firstSegment; segmentIndex < firstSegment + segmentCount; ++segmentIndex) {
+			const mat24 segmentMatrix = calculateSegmentMatrix(segmentIndex, coefficientMatrix, controlPoints);
+
+			vec2 *segmentOutput = output + segmentIndex * stepsPerSegment;
+
+			if (method == TessellationMethod::ForwardDifferencing) {
+				tessellateSegmentForwardDifferencing(segmentMatrix, stepsPerSegment, segmentOutput);
+			} else {
+				tessellateSegment(segmentMatrix, stepsPerSegment, segmentOutput);
+			}
+		}
+	}
+}
+
+void closeCurve(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	vec2 *output
+) {
+	const size_t vertexCount = getTessellatedVertexCount(controlPointCount, basisTable.stepsPerSegment);
+
+	if (vertexCount == 0) {
+		return;
+	}
+
+	const vec4 w = basisTable.weights[basisTable.stepsPerSegment];
+	const vec2 *last = controlPoints + getSegmentCount(controlPointCount) - 1;
+	output[vertexCount - 1] = {
+		last[0].x * w.x + last[1].x * w.y + last[2].x * w.z + last[3].x * w.w,
+		last[0].y * w.x + last[1].y * w.y + last[2].y * w.z + last[3].y * w.w
+	};
+}
+
+void closeCurve(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	vec2 *output,
+	const TessellationMethod method
+) {
+	assert(method != TessellationMethod::BasisTable && "use the BasisTable overload");
+
+	const size_t vertexCount = getTessellatedVertexCount(controlPointCount, stepsPerSegment);
+
+	if (vertexCount == 0) {
+		return;
+	}
+
+	if (method == TessellationMethod::BasisTable) {
+		// Same rounding as the weighted sums of the other samples.
+		const vec4 w = coefficientMatrix * vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		const vec2 *last = controlPoints + getSegmentCount(controlPointCount) - 1;
+		output[vertexCount - 1] = {
+			last[0].x * w.x + last[1].x * w.y + last[2].x * w.z + last[3].x * w.w,
+			last[0].y * w.x + last[1].y * w.y + last[2].y * w.z + last[3].y * w.w
+		};
+	} else {
+		// The end point of the last segment, t = 1.
+		const mat24 lastSegmentMatrix = calculateSegmentMatrix(getSegmentCount(controlPointCount) - 1, coefficientMatrix, controlPoints);
+		output[vertexCount - 1] = lastSegmentMatrix * vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+}
+
+size_t tessellateCurve(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const BasisTable& basisTable,
+	vec2 *output
+) {
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+
+	tessellateSegments(controlPoints, 0, segmentCount, basisTable, output);
+	closeCurve(controlPoints, controlPointCount, basisTable, output);
+
+	return getTessellatedVertexCount(controlPointCount, basisTable.stepsPerSegment);
+}
+
+size_t tessellateCurve(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	vec2 *output,
+	const TessellationMethod method
+) {
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+
+	tessellateSegments(controlPoints, 0, segmentCount, coefficientMatrix, stepsPerSegment, output, method);
+	closeCurve(controlPoints, controlPointCount, coefficientMatrix, stepsPerSegment, output, method);
+
+	return getTessellatedVertexCount(controlPointCount, stepsPerSegment);
+}
+
+namespace {
+
+struct CurveSample {
+	float t;
+	vec2 point;
+	vec2 derivative;
+};
+
+CurveSample sampleSegment(const mat24& gm, const float t) {
+	const vec4 parameterVector = { t * t * t, t * t, t, 1.0f };
+	const vec4 derivativeVector = { 3.0f * t * t, 2.0f * t, 1.0f, 0.0f };
+
+	return { t, gm * parameterVector, gm * derivativeVector };
+}
+
+// Distance of the inner Bezier control points of the span from its chord. The
+// span lies in the convex hull of its Bezier control points, so this bounds
+// how far the curve strays from the straight line between its end points.
+float calculateFlatness(const CurveSample& start, const CurveSample& end) {
+	const float spanLength = (end.t - start.t) / 3.0f;
+	const vec2 control1 = start.point + start.derivative * spanLength;
+	const vec2 control2 = end.point - end.derivative * spanLength;
+
+	const vec2 chord = end.point - start.point;
+	const float chordLength2 = length2(chord);
+
+	if (chordLength2 <= 1.0e-12f) {
+		return sqrtf(std::max(dist2(control1, start.point), dist2(control2, start.point)));
+	}
+
+	const float chordLength = sqrtf(chordLength2);
+	const vec2 d1 = control1 - start.point;
+	const vec2 d2 = control2 - start.point;
+
+	return std::max(
+		fabsf(chord.x * d1.y - chord.y * d1.x),
+		fabsf(chord.x * d2.y - chord.y * d2.x)
+	) / chordLength;
+}
+
+}
+
+size_t tessellateCurveAdaptive(
+	const vec2 *controlPoints,
+	const size_t controlPointCount,
+	const mat4& coefficientMatrix,
+	const float flatnessTolerance,
+	const size_t maximumVerticesPerSegment,
+	std::vector<vec2>& output,
+	AdaptiveTessellationStatistics *statistics
+) {
+	struct Span {
+		CurveSample start;
+		CurveSample end;
+		size_t depth;
+	};
+
+	output.clear();
+
+	AdaptiveTessellationStatistics localStatistics;
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+
+	localStatistics.segmentCount = segmentCount;
+
+	if (segmentCount == 0) {
+		if (statistics != nullptr) {
+			*statistics = localStatistics;
+		}
+
+		return 0;
+	}
+
+	// A segment split to depth d has at most 2^d spans, i.e. 2^d vertices
+	// without its shared end point.
+	size_t maximumDepth = 0;
+	while (((size_t)2 << maximumDepth) <= std::max(maximumVerticesPerSegment, (size_t)1)) {
+		++maximumDepth;
+	}
+
+	std::vector<Span> stack;
+	mat24 gm;
+
+	for (size_t segmentIndex = 0; segmentIndex < segmentCount; ++segmentIndex) {
+		gm = calculateSegmentMatrix(segmentIndex, coefficientMatrix, controlPoints);
+
+		const size_t firstVertex = output.size();
+		bool isCapped = false;
+
+		stack.push_back({ sampleSegment(gm, 0.0f), sampleSegment(gm, 1.0f), 0 });
+
+		while (!stack.empty()) {
+			const Span span = stack.back();
+			stack.pop_back();
+
+			const bool isFlat = calculateFlatness(span.start, span.end) <= flatnessTolerance;
+
+			if (isFlat || span.depth >= maximumDepth) {
+				isCapped = isCapped || !isFlat;
+				output.push_back(span.start.point);
+				continue;
+			}
+
+			const CurveSample middle = sampleSegment(gm, 0.5f * (span.start.t + span.end.t));
+
+			// The right half goes first so that the left half is emitted first.
+			stack.push_back({ middle, span.end, span.depth + 1 });
+			stack.push_back({ span.start, middle, span.depth + 1 });
+		}
+
+		const size_t segmentVertexCount = output.size() - firstVertex;
+
+		if (segmentIndex == 0 || segmentVertexCount < localStatistics.minimumSegmentVertexCount) {
+			localStatistics.minimumSegmentVertexCount = segmentVertexCount;
+		}
+		localStatistics.maximumSegmentVertexCount = std::max(localStatistics.maximumSegmentVertexCount, segmentVertexCount);
+
+		if (isCapped) {
+			++localStatistics.cappedSegmentCount;
+		}
+	}
+
+	// The end point of the last segment, t = 1.
+	output.push_back(gm * vec4(1.0f, 1.0f, 1.0f, 1.0f));
+
+	localStatistics.vertexCount = output.size();
+
+	if (statistics != nullptr) {
+		*statistics = localStatistics;
+	}
+
+	return output.size();
+}
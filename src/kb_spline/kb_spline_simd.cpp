@@ -0,0 +1,325 @@
+#include "kb_spline_simd.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KB_SPLINE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define KB_SPLINE_TARGET_SSE2
+#define KB_SPLINE_TARGET_AVX2
+#else
+#define KB_SPLINE_TARGET_SSE2 __attribute__((target("sse2")))
+#define KB_SPLINE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+mat24 getSegmentMatrix(const CurveSource& source, const size_t segmentIndex, const mat4& coefficientMatrix) {
+	if (source.points != nullptr) {
+		return calculateSegmentMatrix(segmentIndex, coefficientMatrix, source.points);
+	}
+
+	const float *x = source.x + segmentIndex;
+	const float *y = source.y + segmentIndex;
+	const mat24 geometry = {
+		vec4(x[0], x[1], x[2], x[3]),
+		vec4(y[0], y[1], y[2], y[3])
+	};
+
+	return geometry * coefficientMatrix;
+}
+
+void store(const CurveTarget& target, const size_t index, const vec2 point) {
+	if (target.points != nullptr) {
+		target.points[index] = point;
+	} else {
+		target.x[index] = point.x;
+		target.y[index] = point.y;
+	}
+}
+
+// Same expression as operator*(mat24, vec4) with { t^3, t^2, t, 1 }, so that
+// every level produces bit-identical samples.
+void tessellateSamplesScalar(
+	const mat24& gm,
+	const size_t firstStep,
+	const size_t stepsPerSegment,
+	const size_t outputOffset,
+	const CurveTarget& target
+) {
+	const float parameterDelta = 1.0f / (float)stepsPerSegment;
+
+	for (size_t step = firstStep; step < stepsPerSegment; ++step) {
+		const float t = (float)step * parameterDelta;
+		const vec4 parameterVector = { t * t * t, t * t, t, 1.0f };
+
+		store(target, outputOffset + step, gm * parameterVector);
+	}
+}
+
+// Segment matrices are computed in blocks by scalar code, and the vector
+// kernels only evaluate the full 4 / 8 wide sample groups of a block. Calling
+// scalar helpers from inside the AVX2 kernel would cost an SSE/AVX transition
+// per segment.
+const size_t SEGMENT_BLOCK_SIZE = 64;
+
+typedef void (*BlockKernel)(
+	const mat24 *segmentMatrices,
+	const size_t segmentCount,
+	const size_t firstOutputOffset,
+	const size_t stepsPerSegment,
+	const size_t blockedSteps,
+	const CurveTarget& target
+);
+
+void tessellateSegmentsBlocked(
+	const CurveSource& source,
+	const size_t segmentCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	const CurveTarget& target,
+	const size_t lanes,
+	const BlockKernel kernel
+) {
+	const size_t blockedSteps = kernel != nullptr ? stepsPerSegment - stepsPerSegment % lanes : 0;
+
+	mat24 segmentMatrices[SEGMENT_BLOCK_SIZE];
+
+	for (size_t firstSegment = 0; firstSegment < segmentCount; firstSegment += SEGMENT_BLOCK_SIZE) {
+		const size_t blockSize = std::min(SEGMENT_BLOCK_SIZE, segmentCount - firstSegment);
+
+		for (size_t i = 0; i < blockSize; ++i) {
+			segmentMatrices[i] = getSegmentMatrix(source, firstSegment + i, coefficientMatrix);
+		}
+
+		if (blockedSteps > 0) {
+			kernel(segmentMatrices, blockSize, firstSegment * stepsPerSegment, stepsPerSegment, blockedSteps, target);
+		}
+
+		for (size_t i = 0; i < blockSize; ++i) {
+			const size_t outputOffset = (firstSegment + i) * stepsPerSegment;
+
+			tessellateSamplesScalar(segmentMatrices[i], blockedSteps, stepsPerSegment, outputOffset, target);
+		}
+	}
+}
+
+#if defined(KB_SPLINE_X86)
+
+KB_SPLINE_TARGET_SSE2
+void tessellateBlockSse2(
+	const mat24 *segmentMatrices,
+	const size_t segmentCount,
+	const size_t firstOutputOffset,
+	const size_t stepsPerSegment,
+	const size_t blockedSteps,
+	const CurveTarget& target
+) {
+	const size_t LANES = 4;
+
+	const __m128 parameterDelta = _mm_set1_ps(1.0f / (float)stepsPerSegment);
+	const __m128i laneOffsets = _mm_set_epi32(3, 2, 1, 0);
+
+	for (size_t segmentIndex = 0; segmentIndex < segmentCount; ++segmentIndex) {
+		const mat24& gm = segmentMatrices[segmentIndex];
+		const size_t outputOffset = firstOutputOffset + segmentIndex * stepsPerSegment;
+
+		const __m128 ax = _mm_set1_ps(gm.v[0].x), bx = _mm_set1_ps(gm.v[0].y);
+		const __m128 cx = _mm_set1_ps(gm.v[0].z), dx = _mm_set1_ps(gm.v[0].w);
+		const __m128 ay = _mm_set1_ps(gm.v[1].x), by = _mm_set1_ps(gm.v[1].y);
+		const __m128 cy = _mm_set1_ps(gm.v[1].z), dy = _mm_set1_ps(gm.v[1].w);
+
+		for (size_t step = 0; step < blockedSteps; step += LANES) {
+			const __m128i steps = _mm_add_epi32(_mm_set1_epi32((int)step), laneOffsets);
+			const __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(steps), parameterDelta);
+			const __m128 t2 = _mm_mul_ps(t, t);
+			const __m128 t3 = _mm_mul_ps(t2, t);
+
+			const __m128 x = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(ax, t3), _mm_mul_ps(bx, t2)), _mm_mul_ps(cx, t)), dx);
+			const __m128 y = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(ay, t3), _mm_mul_ps(by, t2)), _mm_mul_ps(cy, t)), dy);
+
+			if (target.points != nullptr) {
+				float *output = &target.points[outputOffset + step].x;
+				_mm_storeu_ps(output, _mm_unpacklo_ps(x, y));
+				_mm_storeu_ps(output + 4, _mm_unpackhi_ps(x, y));
+			} else {
+				_mm_storeu_ps(target.x + outputOffset + step, x);
+				_mm_storeu_ps(target.y + outputOffset + step, y);
+			}
+		}
+	}
+}
+
+KB_SPLINE_TARGET_AVX2
+void tessellateBlockAvx2(
+	const mat24 *segmentMatrices,
+	const size_t segmentCount,
+	const size_t firstOutputOffset,
+	const size_t stepsPerSegment,
+	const size_t blockedSteps,
+	const CurveTarget& target
+) {
+	const size_t LANES = 8;
+
+	const __m256 parameterDelta = _mm256_set1_ps(1.0f / (float)stepsPerSegment);
+	const __m256i laneOffsets = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+	for (size_t segmentIndex = 0; segmentIndex < segmentCount; ++segmentIndex) {
+		const mat24& gm = segmentMatrices[segmentIndex];
+		const size_t outputOffset = firstOutputOffset + segmentIndex * stepsPerSegment;
+
+		const __m256 ax = _mm256_set1_ps(gm.v[0].x), bx = _mm256_set1_ps(gm.v[0].y);
+		const __m256 cx = _mm256_set1_ps(gm.v[0].z), dx = _mm256_set1_ps(gm.v[0].w);
+		const __m256 ay = _mm256_set1_ps(gm.v[1].x), by = _mm256_set1_ps(gm.v[1].y);
+		const __m256 cy = _mm256_set1_ps(gm.v[1].z), dy = _mm256_set1_ps(gm.v[1].w);
+
+		for (size_t step = 0; step < blockedSteps; step += LANES) {
+			const __m256i steps = _mm256_add_epi32(_mm256_set1_epi32((int)step), laneOffsets);
+			const __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(steps), parameterDelta);
+			const __m256 t2 = _mm256_mul_ps(t, t);
+			const __m256 t3 = _mm256_mul_ps(t2, t);
+
+			// No FMA on purpose: separate roundings keep the results identical
+			// to the scalar matrix path.
+			const __m256 x = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(ax, t3), _mm256_mul_ps(bx, t2)), _mm256_mul_ps(cx, t)), dx);
+			const __m256 y = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(ay, t3), _mm256_mul_ps(by, t2)), _mm256_mul_ps(cy, t)), dy);
+
+			if (target.points != nullptr) {
+				// unpack works per 128-bit lane: low = points 0-1 | 4-5, high = 2-3 | 6-7.
+				const __m256 low = _mm256_unpacklo_ps(x, y);
+				const __m256 high = _mm256_unpackhi_ps(x, y);
+
+				float *output = &target.points[outputOffset + step].x;
+				_mm256_storeu_ps(output, _mm256_permute2f128_ps(low, high, 0x20));
+				_mm256_storeu_ps(output + 8, _mm256_permute2f128_ps(low, high, 0x31));
+			} else {
+				_mm256_storeu_ps(target.x + outputOffset + step, x);
+				_mm256_storeu_ps(target.y + outputOffset + step, y);
+			}
+		}
+	}
+}
+
+SimdLevel detectSimdLevel() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int maximumLeaf = info[0];
+
+	__cpuid(info, 1);
+	const bool hasSse2 = (info[3] & (1 << 26)) != 0;
+	const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+	const bool hasAvx = (info[2] & (1 << 28)) != 0;
+
+	bool hasAvx2 = false;
+	if (maximumLeaf >= 7 && hasOsxsave && hasAvx && (_xgetbv(0) & 0x6) == 0x6) {
+		__cpuidex(info, 7, 0);
+		hasAvx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	const bool hasSse2 = __builtin_cpu_supports("sse2");
+	const bool hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	if (hasAvx2) {
+		return SimdLevel::Avx2;
+	}
+
+	if (hasSse2) {
+		return SimdLevel::Sse2;
+	}
+
+	return SimdLevel::Scalar;
+}
+
+#else
+
+SimdLevel detectSimdLevel() {
+	return SimdLevel::Scalar;
+}
+
+#endif
+
+}
+
+SimdLevel getSupportedSimdLevel() {
+	static const SimdLevel supportedLevel = detectSimdLevel();
+
+	return supportedLevel;
+}
+
+const char *getSimdLevelName(const SimdLevel level) {
+	switch (level) {
+	case SimdLevel::Avx2:
+		return "AVX2";
+	case SimdLevel::Sse2:
+		return "SSE2";
+	case SimdLevel::Scalar:
+	default:
+		return "scalar";
+	}
+}
+
+void tessellateSegmentsSimd(
+	const CurveSource& source,
+	const size_t segmentCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	const CurveTarget& target,
+	const SimdLevel level
+) {
+	const SimdLevel supportedLevel = getSupportedSimdLevel();
+	const SimdLevel effectiveLevel = level < supportedLevel ? level : supportedLevel;
+
+	size_t lanes = 1;
+	BlockKernel kernel = nullptr;
+
+#if defined(KB_SPLINE_X86)
+	if (effectiveLevel == SimdLevel::Avx2) {
+		lanes = 8;
+		kernel = tessellateBlockAvx2;
+	} else if (effectiveLevel == SimdLevel::Sse2) {
+		lanes = 4;
+		kernel = tessellateBlockSse2;
+	}
+#endif
+
+	tessellateSegmentsBlocked(source, segmentCount, coefficientMatrix, stepsPerSegment, target, lanes, kernel);
+}
+
+size_t tessellateCurveSoA(
+	const float *controlX,
+	const float *controlY,
+	const size_t controlPointCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	float *outputX,
+	float *outputY,
+	const SimdLevel level
+) {
+	const size_t vertexCount = getTessellatedVertexCount(controlPointCount, stepsPerSegment);
+
+	if (vertexCount == 0) {
+		return 0;
+	}
+
+	const size_t segmentCount = getSegmentCount(controlPointCount);
+	const CurveSource source = { nullptr, controlX, controlY };
+	const CurveTarget target = { nullptr, outputX, outputY };
+
+	tessellateSegmentsSimd(source, segmentCount, coefficientMatrix, stepsPerSegment, target, level);
+
+	// The end point of the last segment, t = 1.
+	const mat24 lastSegmentMatrix = getSegmentMatrix(source, segmentCount - 1, coefficientMatrix);
+	store(target, vertexCount - 1, lastSegmentMatrix * vec4(1.0f, 1.0f, 1.0f, 1.0f));
+
+	return vertexCount;
+}
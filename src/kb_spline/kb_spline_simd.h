@@ -0,0 +1,30 @@
+#ifndef H___KB_SPLINE_SIMD
+#define H___KB_SPLINE_SIMD
+
+#include "kb_spline.h"
+
+// Evaluates segments [0, segmentCount) into output without the closing t = 1
+// vertex. Exactly one of the AoS (points) or SoA (x, y) pointers is used on
+// each side.
+struct CurveSource {
+	const vec2 *points;
+	const float *x;
+	const float *y;
+};
+
+struct CurveTarget {
+	vec2 *points;
+	float *x;
+	float *y;
+};
+
+void tessellateSegmentsSimd(
+	const CurveSource& source,
+	const size_t segmentCount,
+	const mat4& coefficientMatrix,
+	const size_t stepsPerSegment,
+	const CurveTarget& target,
+	const SimdLevel level
+);
+
+#endif // !H___KB_SPLINE_SIMD
@@ -0,0 +1,139 @@
+#include "kb_tessellation_worker.h"
+#include "kb_trace.h"
+
+#include <algorithm>
+
+void TessellationWorker::start(TessellationThreadPool *threadPool, const std::function<void()>& onResultPublished) {
+	mThreadPool = threadPool;
+	mOnResultPublished = onResultPublished;
+	mIsStopping = false;
+
+	mThread = std::thread(&TessellationWorker::run, this);
+}
+
+void TessellationWorker::stop() {
+	if (!mThread.joinable()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mWakeUpMutex);
+		mIsStopping = true;
+	}
+
+	mWakeUp.notify_one();
+	mThread.join();
+}
+
+TessellationRequest& TessellationWorker::getRequestBuffer() {
+	return mRequests.getWriteBuffer();
+}
+
+void TessellationWorker::submitRequest() {
+	mRequests.publish();
+
+	// The lock is only held by the worker while it checks for a request, it
+	// prevents the notification from slipping in before the worker waits.
+	{
+		std::lock_guard<std::mutex> lock(mWakeUpMutex);
+	}
+
+	mWakeUp.notify_one();
+}
+
+bool TessellationWorker::fetchResult() {
+	return mResults.update();
+}
+
+const TessellationResult& TessellationWorker::getResult() const {
+	return mResults.getReadBuffer();
+}
+
+void TessellationWorker::run() {
+	setTraceThreadName("Tessellation worker");
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mWakeUpMutex);
+
+			mWakeUp.wait(lock, [this]() { return mIsStopping || mRequests.hasUpdate(); });
+
+			if (mIsStopping) {
+				return;
+			}
+		}
+
+		mRequests.update();
+
+		TessellationResult& result = mResults.getWriteBuffer();
+
+		tessellate(mRequests.getReadBuffer(), result);
+
+		result.sequence = ++mSequence;
+		mResults.publish();
+
+		if (mOnResultPublished) {
+			mOnResultPublished();
+		}
+	}
+}
+
+void TessellationWorker::tessellate(TessellationRequest& request, TessellationResult& result) {
+	KB_TRACE_SCOPE("Background tessellation");
+
+	const std::vector<vec2>& points = request.controlPoints;
+	const size_t stepsPerSegment = request.basisTable.stepsPerSegment;
+
+	result.statistics = AdaptiveTessellationStatistics();
+	result.statistics.segmentCount = getSegmentCount(points.size());
+
+	if (request.isAdaptive) {
+		result.statistics.vertexCount = tessellateCurveAdaptive(
+			points.data(),
+			points.size(),
+			request.basisTable.coefficientMatrix,
+			request.flatnessTolerance,
+			request.maximumVerticesPerSegment,
+			result.vertices,
+			&result.statistics
+		);
+		result.changedRange = { 0, result.vertices.size() };
+
+		// Neither the cache nor the other result buffers hold these vertices.
+		invalidateCurveCache(mCurveCache);
+		recordFullChange(mVertexChanges);
+	} else {
+		VertexRange changedPoints;
+
+		if (!getChangesSince(request.controlPointChanges, mControlPointVersion, changedPoints)) {
+			invalidateCurveCache(mCurveCache);
+		} else if (changedPoints.count > 0 && changedPoints.first < points.size()) {
+			// Appended points are picked up by the cache itself.
+			invalidateControlPoint(mCurveCache, changedPoints.first);
+			invalidateControlPoint(mCurveCache, std::min(changedPoints.first + changedPoints.count, points.size()) - 1);
+		}
+
+		const VertexRange changedRange = updateCurveCache(
+			mCurveCache,
+			points.data(),
+			points.size(),
+			request.basisTable,
+			request.method,
+			mThreadPool
+		);
+
+		recordChange(mVertexChanges, changedRange);
+
+		// The result buffer last held an older result; only what changed since
+		// is copied into it.
+		updateCopy(result.vertices, result.vertexVersion, mVertexChanges, mCurveCache.vertices.data(), mCurveCache.vertices.size());
+		result.changedRange = changedRange;
+
+		result.statistics.vertexCount = result.vertices.size();
+		result.statistics.minimumSegmentVertexCount = stepsPerSegment;
+		result.statistics.maximumSegmentVertexCount = stepsPerSegment;
+	}
+
+	result.vertexVersion = mVertexChanges.version;
+	mControlPointVersion = request.controlPointChanges.version;
+}
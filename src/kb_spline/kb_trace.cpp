@@ -0,0 +1,153 @@
+#include "kb_trace.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+std::atomic<bool> isTracing(false);
+
+namespace {
+
+struct TraceEvent {
+	const char *name;
+	uint64_t startTime;
+	uint64_t endTime;
+};
+
+struct ThreadTraceBuffer {
+	size_t threadId;
+	std::string threadName;
+
+	std::vector<TraceEvent> events;
+
+	// Number of events ever recorded; written by the owner thread only.
+	std::atomic<uint64_t> recordedEventCount{ 0 };
+};
+
+// Guards the list of buffers, not the buffers themselves.
+std::mutex threadBuffersMutex;
+std::vector<std::unique_ptr<ThreadTraceBuffer>> threadBuffers;
+
+size_t eventsPerThreadBuffer = 0;
+uint64_t traceStartTime = 0;
+
+thread_local ThreadTraceBuffer *threadBuffer = nullptr;
+
+ThreadTraceBuffer *getThreadBuffer() {
+	if (threadBuffer == nullptr) {
+		std::unique_ptr<ThreadTraceBuffer> buffer(new ThreadTraceBuffer());
+		buffer->events.resize(eventsPerThreadBuffer);
+
+		std::lock_guard<std::mutex> lock(threadBuffersMutex);
+
+		buffer->threadId = threadBuffers.size();
+		buffer->threadName = "Thread " + std::to_string(buffer->threadId);
+
+		// The buffer outlives its thread, so pool threads that already exited
+		// still show up in the trace.
+		threadBuffer = buffer.get();
+		threadBuffers.push_back(std::move(buffer));
+	}
+
+	return threadBuffer;
+}
+
+void writeEscaped(FILE *file, const char *text) {
+	for (const char *c = text; *c != '\0'; ++c) {
+		if (*c == '"' || *c == '\\') {
+			fputc('\\', file);
+		}
+
+		fputc(*c, file);
+	}
+}
+
+}
+
+void startTrace(const size_t eventsPerThread) {
+	if (isTraceEnabled()) {
+		return;
+	}
+
+	eventsPerThreadBuffer = std::max<size_t>(eventsPerThread, 1);
+	traceStartTime = getTraceTime();
+
+	isTracing.store(true, std::memory_order_release);
+}
+
+bool writeTrace(const char *path) {
+	isTracing.store(false, std::memory_order_release);
+
+	FILE *file = fopen(path, "w");
+
+	if (file == nullptr) {
+		return false;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	std::lock_guard<std::mutex> lock(threadBuffersMutex);
+
+	bool isFirstEvent = true;
+
+	for (const auto& buffer : threadBuffers) {
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"",
+			isFirstEvent ? "" : ",\n", buffer->threadId);
+		writeEscaped(file, buffer->threadName.c_str());
+		fprintf(file, "\"}}");
+
+		isFirstEvent = false;
+
+		const uint64_t recordedEventCount = buffer->recordedEventCount.load(std::memory_order_acquire);
+		const size_t capacity = buffer->events.size();
+		const uint64_t firstEvent = recordedEventCount > capacity ? recordedEventCount - capacity : 0;
+
+		for (uint64_t i = firstEvent; i < recordedEventCount; ++i) {
+			const TraceEvent& event = buffer->events[i % capacity];
+
+			// Microseconds since the start of the trace.
+			fprintf(file, ",\n{\"name\":\"");
+			writeEscaped(file, event.name);
+			fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+				buffer->threadId,
+				(double)((int64_t)(event.startTime - traceStartTime)) / 1000.0,
+				(double)(event.endTime - event.startTime) / 1000.0
+			);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+
+	return fclose(file) == 0;
+}
+
+void setTraceThreadName(const char *name) {
+	if (!isTraceEnabled()) {
+		return;
+	}
+
+	ThreadTraceBuffer *buffer = getThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(threadBuffersMutex);
+	buffer->threadName = name;
+}
+
+uint64_t getTraceTime() {
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+void recordTraceEvent(const char *name, const uint64_t startTime, const uint64_t endTime) {
+	ThreadTraceBuffer *buffer = getThreadBuffer();
+
+	const uint64_t index = buffer->recordedEventCount.load(std::memory_order_relaxed);
+
+	buffer->events[index % buffer->events.size()] = { name, startTime, endTime };
+	buffer->recordedEventCount.store(index + 1, std::memory_order_release);
+}
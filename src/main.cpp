@@ -7,7 +7,13 @@
 */
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <random>
 
 #if defined(NANOGUI_GLAD)
 #if defined(NANOGUI_SHARED) && !defined(GLAD_GLAPI_EXPORT)
@@ -27,6 +33,21 @@
 #include <nanogui/nanogui.h>
 
 #include "bevgrafmath2017.h"
+#include "curve_renderer.h"
+#include "frame_profiler.h"
+#include "input_log.h"
+#include "kb_curve_cache.h"
+#include "kb_curve_export.h"
+#include "kb_parallel.h"
+#include "kb_point_file.h"
+#include "kb_point_grid.h"
+#include "kb_point_import.h"
+#include "kb_sliced_tessellator.h"
+#include "kb_slot_map.h"
+#include "kb_spline.h"
+#include "kb_tessellation_worker.h"
+#include "kb_trace.h"
+#include "point_loader.h"
 
 
 const int CONTEXT_VERSION_MAJOR = 3;
@@ -40,37 +61,229 @@ const char *APPLICATION_TITLE = "Kochanek-Bartels Spline";
 
 nanogui::Screen *screen = nullptr;
 
-const int MINIMUM_NUMBER_OF_CONTROL_POINTS = 4;
+// Squared distance in pixels.
 const float CLICK_THRESHOLD = 100.0f;
 
-const float PARAMETER_DELTA = 0.05f;
+const size_t STEPS_PER_SEGMENT = 20;
 
-std::vector<vec2> controlPoints;
+// NanoGUI fades tooltips and similar effects for a while after the last
+// interaction; redraw-on-demand keeps refreshing at this rate until then.
+const double ANIMATION_DURATION = 1.0;
+const double ANIMATION_REFRESH_INTERVAL = 0.05;
+const double CPU_USAGE_INTERVAL = 1.0;
+
+const float FLATNESS_TOLERANCE = 0.25f;
+const size_t MAXIMUM_VERTICES_PER_SEGMENT = 64;
+
+// Half of a 60 Hz frame, the rest is left for drawing and the GUI.
+const double TIME_SLICE_BUDGET = 0.008;
+
+// Frame times at the top of the timing graph, in milliseconds.
+const float FRAME_TIME_GRAPH_RANGE = 33.3f;
+
+// Dense in curve order; the GUI refers to points through stable handles.
+SlotMap<vec2> controlPoints;
+std::vector<vec2> curveVertices;
+CurveCache curveCache;
+
+// Cells as wide as the click radius, so a query only visits 3x3 cells.
+PointGrid controlPointGrid;
+
+BasisTable basisTable;
 
 float tension = 0.0f;
 float bias = 0.0f;
 float continuity = 0.0f;
 
+TessellationMethod tessellationMethod = TessellationMethod::Matrix;
+
+bool isAdaptiveTessellation = false;
+AdaptiveTessellationStatistics tessellationStatistics;
+
+bool isRedrawOnDemand = true;
+bool isRetainedModeRendering = true;
+bool isGpuEvaluation = false;
+
+CurveRenderer curveRenderer;
+
+// Only measures while the timing window is shown.
+FrameProfiler frameProfiler;
+
+// Evaluates large dirty ranges of the curve cache on several threads.
+TessellationThreadPool *tessellationThreadPool = nullptr;
+
+// Tessellates on its own thread so that huge curves never stall the input.
+bool isBackgroundTessellation = true;
+TessellationWorker tessellationWorker;
+
+// Tessellates on the render thread in per-frame slices, for targets that
+// cannot use threads. Takes precedence over the background thread.
+bool isTimeSlicedTessellation = false;
+SlicedTessellator slicedTessellator;
+
+// Set by --single-thread: the pool, the background tessellator and the point
+// loader thread are never created, everything runs on the render thread.
+bool isSingleThreaded = false;
+
+// Incremented whenever the control points change, so that they are only
+// uploaded to the GPU when needed.
+uint64_t controlPointsVersion = 0;
+
+// The control points changed by the last versions, so that the copy handed
+// to the background tessellator is only patched.
+ChangeHistory controlPointChanges;
+
+// Incremented whenever the tension, the method or the adaptive mode changes.
+uint64_t curveSettingsVersion = 0;
+
+// Incremented by every change that needs a new frame.
+uint64_t sceneVersion = 0;
+double lastSceneChangeTime = 0.0;
+
 bool isDrawControlPolygon = true;
 bool isDrawControlPoints = true;
 
-vec2 *draggedControlPoint = nullptr;
+SlotHandle draggedControlPoint = NULL_SLOT_HANDLE;
+
+// The position of the last cursor event, so that a replayed click lands where
+// the recorded one did.
+vec2 cursorPosition = { 0.0f, 0.0f };
+
+// Records the input callbacks behind --record, or drives them from a log
+// behind --replay.
+InputRecorder inputRecorder;
+InputPlayer inputPlayer;
+
+// Loads dropped and opened point files without stalling the frames.
+PointLoader pointLoader;
 
 GLFWwindow *createWindow();
 void setupInputCallbacks(GLFWwindow * const window);
 
-mat4 calculateCoefficientMatrix(const float tension, const float bias, const float continuity);
+void invalidateScene();
 
-void drawCurve(const mat4& coefficientMatrix, const std::vector<vec2>& controlPoints);
-void drawSegment(const size_t segmentIndex, const mat4& coefficientMatrix, const std::vector<vec2>& controlPoints);
-void drawControlPolygon(const std::vector<vec2>& controlPoints);
-void drawControlPoints(const std::vector<vec2>& controlPoints);
+void tessellateCurveForFrame(
+	const mat4& coefficientMatrix,
+	const SlotMap<vec2>& controlPoints,
+	const vec2 *& vertices,
+	size_t& vertexCount,
+	VertexRange& changedRange
+);
+void drawCurve(const vec2 *vertices, const size_t vertexCount);
+void drawControlPolygon(const SlotMap<vec2>& controlPoints);
+void drawControlPoints(const SlotMap<vec2>& controlPoints);
+
+std::string formatTessellationStatistics(const AdaptiveTessellationStatistics& statistics);
+std::string formatCpuUsage(const float continuousCpuUsage, const float onDemandCpuUsage);
+std::string formatFrameTimeStatistics(const FrameTimeStatistics& statistics);
 
 void onMouseMove(GLFWwindow *window, double x, double y);
 void onMouseClick(GLFWwindow *window, int button, int action, int modifiers);
-vec2 *getClickedPoint(const vec2& cursorPosition, std::vector<vec2>& controlPoints);
+void onKey(GLFWwindow *window, int key, int scancode, int action, int modifiers);
+void onCharacter(GLFWwindow *window, unsigned int codepoint);
+void onScroll(GLFWwindow *window, double x, double y);
+void onFrameBufferResize(GLFWwindow *window, int width, int height);
+// Framebuffer pixels per screen coordinate.
+float getFrameBufferScale(GLFWwindow *window);
+void onDrop(GLFWwindow *window, int count, const char **filenames);
+void dispatchInputEvent(GLFWwindow *window, const InputEvent& event);
+SlotHandle getClickedPoint(const vec2& cursorPosition, const SlotMap<vec2>& controlPoints);
+
+void insertControlPoint(const size_t index, const vec2& position);
+void eraseControlPoint(const SlotHandle handle);
+
+// Starts loading a point file (.kbp) or a CSV / text file in the background.
+void startLoadingControlPoints(const std::string& path);
+
+// Replaces the control points (and the TCB parameters of a point file) with
+// a finished load.
+void swapInLoadedPoints(LoadedPoints& loadedPoints);
+
+bool saveControlPoints(const char *path);
+
+// Streams the curve to an SVG file as exact Bezier segments, or to a point
+// file (.kbp) as the polyline of STEPS_PER_SEGMENT steps per segment.
+bool exportCurveFile(const std::string& path);
+
+// Replaces the control points with a CSV or text file, or with stdin if path
+// is "-". The current points are kept if the import fails.
+bool importControlPoints(const char *path);
+
+// Rebuilds everything derived from the control points after replacing them.
+void resetControlPointState();
+
+void submitTessellationRequest();
+
+void reportThreadScaling(const size_t maximumThreadCount);
 
 int main(int argc, char **argv) {
+	size_t threadCount = getHardwareThreadCount();
+	bool isThreadScalingReport = false;
+	const char *tracePath = nullptr;
+	const char *recordPath = nullptr;
+	const char *replayPath = nullptr;
+	bool isRealTimeReplay = false;
+	const char *importPath = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threadCount = (size_t)std::max(atoi(argv[++i]), 1);
+		} else if (strcmp(argv[i], "--report-threads") == 0) {
+			isThreadScalingReport = true;
+		} else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			tracePath = argv[++i];
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replayPath = argv[++i];
+		} else if (strcmp(argv[i], "--replay-realtime") == 0) {
+			isRealTimeReplay = true;
+		} else if (strcmp(argv[i], "--import") == 0 && i + 1 < argc) {
+			importPath = argv[++i];
+		} else if (strcmp(argv[i], "--single-thread") == 0) {
+			isSingleThreaded = true;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--threads N | --single-thread] [--report-threads] [--trace out.json]"
+				" [--record input.kbil | --replay input.kbil [--replay-realtime]] [--import points.csv|-]" << std::endl;
+			return -1;
+		}
+	}
+
+	if (recordPath != nullptr && replayPath != nullptr) {
+		std::cerr << "Cannot record and replay at the same time" << std::endl;
+		return -1;
+	}
+
+	if (isSingleThreaded && isThreadScalingReport) {
+		std::cerr << "Cannot report the thread scaling with a single thread" << std::endl;
+		return -1;
+	}
+
+	if (isSingleThreaded) {
+		isTimeSlicedTessellation = true;
+		isBackgroundTessellation = false;
+	}
+
+	if (replayPath != nullptr && !inputPlayer.open(replayPath)) {
+		std::cerr << "Failed to read the input log " << replayPath << std::endl;
+		return -1;
+	}
+
+	if (tracePath != nullptr) {
+		startTrace();
+		setTraceThreadName("Main");
+	}
+
+	if (isThreadScalingReport) {
+		reportThreadScaling(threadCount);
+
+		if (tracePath != nullptr && !writeTrace(tracePath)) {
+			std::cerr << "Failed to write the trace to " << tracePath << std::endl;
+		}
+
+		return 0;
+	}
+
 	glfwInit();
 	glfwSetTime(0);
 
@@ -110,6 +323,18 @@ int main(int argc, char **argv) {
 	glfwSwapInterval(0);
 	glfwSwapBuffers(window);
 
+	if (!curveRenderer.init()) {
+		std::cerr << "Failed to initialize the retained-mode renderer!" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+
+	if (!slicedTessellator.init()) {
+		std::cerr << "Failed to allocate the tessellation coroutine!" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+
 	nanogui::Window *controlWindow = new nanogui::Window(screen, "Controls");
 	controlWindow->setPosition(nanogui::Vector2i(15, 15));
 	controlWindow->setLayout(new nanogui::GroupLayout());
@@ -136,6 +361,7 @@ int main(int argc, char **argv) {
 	tensionSlider->setCallback([tensionValueLabel](float value) {
 		tensionValueLabel->setCaption(std::to_string(value));
 		tension = value;
+		++curveSettingsVersion;
 	});
 
 
@@ -154,36 +380,566 @@ int main(int argc, char **argv) {
 		isDrawControlPolygon = value;
 	});
 
+	nanogui::Widget *evaluatorPanel = new nanogui::Widget(controlWindow);
+	evaluatorPanel->setLayout(new nanogui::BoxLayout(
+		nanogui::Orientation::Horizontal,
+		nanogui::Alignment::Middle,
+		0,
+		20
+	));
+
+	nanogui::Label *evaluatorLabel = new nanogui::Label(evaluatorPanel, "Evaluator");
+
+	nanogui::ComboBox *evaluatorComboBox =
+		new nanogui::ComboBox(evaluatorPanel, { "Matrix", "Forward differencing", "SIMD", "Basis table" });
+	evaluatorComboBox->setCallback([](int index) {
+		tessellationMethod = (TessellationMethod)index;
+		++curveSettingsVersion;
+	});
+
+	nanogui::Widget *adaptivePanel = new nanogui::Widget(controlWindow);
+	adaptivePanel->setLayout(new nanogui::BoxLayout(
+		nanogui::Orientation::Horizontal,
+		nanogui::Alignment::Middle,
+		0,
+		20
+	));
+
+	nanogui::CheckBox *adaptiveCheckBox =
+		new nanogui::CheckBox(adaptivePanel, "Adaptive tessellation");
+	adaptiveCheckBox->setChecked(isAdaptiveTessellation);
+	adaptiveCheckBox->setCallback([](bool value) {
+		isAdaptiveTessellation = value;
+		++curveSettingsVersion;
+	});
+
+	nanogui::Label *statisticsLabel =
+		new nanogui::Label(controlWindow, formatTessellationStatistics(tessellationStatistics));
+
+	nanogui::CheckBox *redrawOnDemandCheckBox =
+		new nanogui::CheckBox(controlWindow, "Redraw on demand");
+	redrawOnDemandCheckBox->setChecked(isRedrawOnDemand);
+	redrawOnDemandCheckBox->setCallback([](bool value) {
+		isRedrawOnDemand = value;
+	});
+
+	nanogui::CheckBox *retainedModeCheckBox =
+		new nanogui::CheckBox(controlWindow, "Retained-mode rendering");
+	retainedModeCheckBox->setChecked(isRetainedModeRendering);
+	retainedModeCheckBox->setCallback([](bool value) {
+		isRetainedModeRendering = value;
+	});
+
+	nanogui::CheckBox *gpuEvaluationCheckBox =
+		new nanogui::CheckBox(controlWindow, "Evaluate curve on GPU");
+	gpuEvaluationCheckBox->setChecked(isGpuEvaluation);
+	gpuEvaluationCheckBox->setCallback([](bool value) {
+		isGpuEvaluation = value;
+	});
+
+	nanogui::CheckBox *backgroundTessellationCheckBox =
+		new nanogui::CheckBox(controlWindow, "Tessellate in background");
+	backgroundTessellationCheckBox->setChecked(isBackgroundTessellation);
+	backgroundTessellationCheckBox->setCallback([](bool value) {
+		isBackgroundTessellation = value;
+		// The uploaded vertices came from the other evaluator.
+		curveRenderer.invalidate();
+	});
+	// There is no background thread to turn on.
+	backgroundTessellationCheckBox->setEnabled(!isSingleThreaded);
+
+	nanogui::CheckBox *timeSlicedTessellationCheckBox =
+		new nanogui::CheckBox(controlWindow, "Time-sliced tessellation");
+	timeSlicedTessellationCheckBox->setChecked(isTimeSlicedTessellation);
+	timeSlicedTessellationCheckBox->setCallback([](bool value) {
+		isTimeSlicedTessellation = value;
+		curveRenderer.invalidate();
+	});
+	timeSlicedTessellationCheckBox->setEnabled(!isSingleThreaded);
+
+	// The last measured process CPU usage of both loop modes, -1 if unknown.
+	float continuousCpuUsage = -1.0f;
+	float onDemandCpuUsage = -1.0f;
+
+	nanogui::Label *cpuUsageLabel =
+		new nanogui::Label(controlWindow, formatCpuUsage(continuousCpuUsage, onDemandCpuUsage));
+
+	nanogui::Widget *filePanel = new nanogui::Widget(controlWindow);
+	filePanel->setLayout(new nanogui::BoxLayout(
+		nanogui::Orientation::Horizontal,
+		nanogui::Alignment::Middle,
+		0,
+		20
+	));
+
+	nanogui::Button *openButton = new nanogui::Button(filePanel, "Open points");
+	openButton->setCallback([]() {
+		const std::string path = nanogui::file_dialog({
+			{ "kbp", "Control points" },
+			{ "csv", "Comma-separated points" },
+			{ "txt", "Text points" }
+		}, false);
+
+		if (!path.empty()) {
+			startLoadingControlPoints(path);
+		}
+	});
+
+	nanogui::Button *saveButton = new nanogui::Button(filePanel, "Save points");
+	saveButton->setCallback([]() {
+		const std::string path = nanogui::file_dialog({ { "kbp", "Control points" } }, true);
+
+		if (!path.empty() && !saveControlPoints(path.c_str())) {
+			std::cerr << "Failed to save the point file " << path << std::endl;
+		}
+	});
+
+	nanogui::Button *exportButton = new nanogui::Button(filePanel, "Export curve");
+	exportButton->setCallback([]() {
+		const std::string path = nanogui::file_dialog({
+			{ "svg", "SVG path" },
+			{ "kbp", "Polyline points" }
+		}, true);
+
+		if (!path.empty() && !exportCurveFile(path)) {
+			std::cerr << "Failed to export the curve to " << path << std::endl;
+		}
+	});
+
+	int windowWidth, windowHeight;
+	glfwGetWindowSize(window, &windowWidth, &windowHeight);
+
+	nanogui::Window *timingWindow = new nanogui::Window(screen, "Frame timing");
+	timingWindow->setPosition(nanogui::Vector2i(windowWidth - 300, 15));
+	timingWindow->setLayout(new nanogui::GroupLayout());
+	timingWindow->setVisible(false);
+
+	nanogui::Graph *frameTimeGraph = new nanogui::Graph(timingWindow, "Frame time");
+	frameTimeGraph->setFixedWidth(260);
+
+	nanogui::Label *stageLabels[FRAME_STAGE_COUNT];
+	for (size_t stage = 0; stage < FRAME_STAGE_COUNT; ++stage) {
+		stageLabels[stage] = new nanogui::Label(timingWindow, getFrameStageName((FrameStage)stage));
+		stageLabels[stage]->setFixedWidth(260);
+	}
+
+	nanogui::Label *drawnVertexCountLabel = new nanogui::Label(timingWindow, "Curve vertices: 0");
+	drawnVertexCountLabel->setFixedWidth(260);
+
+	nanogui::Window *loadingWindow = new nanogui::Window(screen, "Loading points");
+	loadingWindow->setPosition(nanogui::Vector2i(windowWidth / 2 - 150, windowHeight / 2 - 40));
+	loadingWindow->setLayout(new nanogui::GroupLayout());
+	loadingWindow->setVisible(false);
+
+	nanogui::ProgressBar *loadingProgressBar = new nanogui::ProgressBar(loadingWindow);
+	loadingProgressBar->setFixedWidth(260);
+
+	nanogui::CheckBox *timingCheckBox =
+		new nanogui::CheckBox(controlWindow, "Show frame timing");
+	timingCheckBox->setChecked(false);
+	timingCheckBox->setCallback([timingWindow](bool value) {
+		timingWindow->setVisible(value);
+		frameProfiler.setEnabled(value);
+	});
+
+	updateBasisTable(basisTable, tension, bias, continuity, STEPS_PER_SEGMENT);
+
+	// A null pool evaluates and imports on the calling thread.
+	if (!isSingleThreaded) {
+		tessellationThreadPool = createTessellationThreadPool(threadCount);
+		tessellationWorker.start(tessellationThreadPool, []() {
+			// Wakes up glfwWaitEventsTimeout(), the result needs a new frame.
+			glfwPostEmptyEvent();
+		});
+	}
+	buildPointGrid(controlPointGrid, sqrtf(CLICK_THRESHOLD), controlPoints.data(), controlPoints.size());
+
+	if (importPath != nullptr && !importControlPoints(importPath)) {
+		std::cerr << "Failed to import the points from " << importPath << std::endl;
+	}
+
 	screen->setVisible(true);
 	screen->performLayout();
 
 	setupInputCallbacks(window);
 
+	if (recordPath != nullptr) {
+		if (!inputRecorder.open(recordPath, windowWidth, windowHeight, glfwGetTime())) {
+			std::cerr << "Failed to create the input log " << recordPath << std::endl;
+		}
+	}
+
+	double replayStartTime = 0.0;
+
+	// A replay draws the curve of every frame's input, not whichever
+	// asynchronous result happens to be ready, so it is tessellated on the
+	// render thread in one go for the whole replay.
+	const bool isReplay = inputPlayer.isReplaying();
+
+	if (isReplay) {
+		// The recorded cursor positions are only valid in the same window.
+		glfwSetWindowSize(window, inputPlayer.getWindowWidth(), inputPlayer.getWindowHeight());
+
+		// The live resize callback is ignored during a replay.
+		const float frameBufferScale = getFrameBufferScale(window);
+		onFrameBufferResize(
+			window,
+			(int)std::lround(inputPlayer.getWindowWidth() * frameBufferScale),
+			(int)std::lround(inputPlayer.getWindowHeight() * frameBufferScale)
+		);
+
+		// The summary at the end of the replay comes from the profiler.
+		frameProfiler.setEnabled(true);
+
+		replayStartTime = glfwGetTime();
+	}
+
+	size_t drawnFrameCount = 0;
+
+	uint64_t drawnSceneVersion = sceneVersion - 1;
+	uint64_t uploadedControlPointsVersion = controlPointsVersion - 1;
+	uint64_t uploadedControlPointTextureVersion = controlPointsVersion - 1;
+	uint64_t submittedControlPointsVersion = controlPointsVersion - 1;
+	uint64_t submittedCurveSettingsVersion = curveSettingsVersion;
+	uint64_t uploadedResultSequence = 0;
+	uint64_t slicedControlPointsVersion = controlPointsVersion - 1;
+	uint64_t slicedCurveSettingsVersion = curveSettingsVersion;
+
+	std::clock_t cpuUsageStartClock = std::clock();
+	double cpuUsageStartTime = glfwGetTime();
+	bool cpuUsageMode = isRedrawOnDemand;
+
 	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
+		if (inputPlayer.isReplaying()) {
+			if (isRealTimeReplay) {
+				double delay;
+				while ((delay = replayStartTime + inputPlayer.getNextFrameTime() - glfwGetTime()) > 0.0) {
+					glfwWaitEventsTimeout(delay);
+				}
+			}
+
+			frameProfiler.beginFrame();
+
+			// Live input is dropped by the callbacks during a replay, but the
+			// window system still needs its events.
+			glfwPollEvents();
+
+			size_t eventCount;
+			const InputEvent *events = inputPlayer.nextFrame(eventCount);
+
+			for (size_t i = 0; i < eventCount; ++i) {
+				dispatchInputEvent(window, events[i]);
+			}
+
+			if (!inputPlayer.isReplaying()) {
+				// Finishes the last frame before the window is closed.
+				glfwSetWindowShouldClose(window, GLFW_TRUE);
+			}
+		} else if (isRedrawOnDemand) {
+			const bool isAnimating = glfwGetTime() - lastSceneChangeTime < ANIMATION_DURATION;
+
+			glfwWaitEventsTimeout(isAnimating ? ANIMATION_REFRESH_INTERVAL : CPU_USAGE_INTERVAL);
+
+			// Waiting is idle time; the callbacks that ran inside the wait
+			// added their own time to the Events stage.
+			frameProfiler.beginFrame();
+		} else {
+			frameProfiler.beginFrame();
+
+			glfwPollEvents();
+		}
+
+		frameProfiler.endStage(FrameStage::Events);
+
+		inputRecorder.endFrame(glfwGetTime());
+
+		const double currentTime = glfwGetTime();
+
+		if (currentTime - cpuUsageStartTime >= CPU_USAGE_INTERVAL || cpuUsageMode != isRedrawOnDemand) {
+			// std::clock() measures the CPU time of the process.
+			const std::clock_t currentClock = std::clock();
+			const float cpuUsage = 100.0f * (float)((double)(currentClock - cpuUsageStartClock) / CLOCKS_PER_SEC / (currentTime - cpuUsageStartTime));
+
+			if (cpuUsageMode) {
+				onDemandCpuUsage = cpuUsage;
+			} else {
+				continuousCpuUsage = cpuUsage;
+			}
+
+			// Only a new frame, without restarting the animation refresh.
+			cpuUsageLabel->setCaption(formatCpuUsage(continuousCpuUsage, onDemandCpuUsage));
+			++sceneVersion;
+
+			cpuUsageStartClock = currentClock;
+			cpuUsageStartTime = currentTime;
+			cpuUsageMode = isRedrawOnDemand;
+		}
+
+		// The old points stay on screen until the new ones are complete.
+		if (pointLoader.isLoading()) {
+			if (!loadingWindow->visible() || loadingProgressBar->value() != pointLoader.getProgress()) {
+				loadingWindow->setVisible(true);
+				loadingProgressBar->setValue(pointLoader.getProgress());
+				++sceneVersion;
+			}
+		} else {
+			LoadedPoints loadedPoints;
+
+			if (pointLoader.fetchResult(loadedPoints)) {
+				loadingWindow->setVisible(false);
+
+				if (loadedPoints.isLoaded) {
+					swapInLoadedPoints(loadedPoints);
+
+					tensionSlider->setValue(tension);
+					tensionValueLabel->setCaption(std::to_string(tension));
+				} else {
+					std::cerr << "Failed to open the point file " << loadedPoints.path << std::endl;
+				}
+
+				++sceneVersion;
+			}
+
+			// The replaced points are freed here, after the swap.
+		}
+
+		updateBasisTable(basisTable, tension, bias, continuity, STEPS_PER_SEGMENT);
+
+		frameProfiler.endStage(FrameStage::BasisTable);
+
+		// GPU-side evaluation needs the retained-mode renderer.
+		const bool isCurveEvaluatedOnGpu = isGpuEvaluation && isRetainedModeRendering;
+		const bool isCurveEvaluatedInSlices = isTimeSlicedTessellation && !isCurveEvaluatedOnGpu && !isReplay;
+		const bool isCurveEvaluatedInBackground =
+			isBackgroundTessellation && !isCurveEvaluatedOnGpu && !isCurveEvaluatedInSlices && !isReplay;
+
+		VertexRange changedCurveRange = { 0, 0 };
+
+		if (isCurveEvaluatedInSlices) {
+			if (slicedControlPointsVersion != controlPointsVersion || slicedCurveSettingsVersion != curveSettingsVersion) {
+				slicedTessellator.start(controlPoints.data(), controlPoints.size(), basisTable, tessellationMethod);
+
+				slicedControlPointsVersion = controlPointsVersion;
+				slicedCurveSettingsVersion = curveSettingsVersion;
+			}
+
+			if (!slicedTessellator.isFinished()) {
+				if (!slicedTessellator.resume(TIME_SLICE_BUDGET)) {
+					// Do not wait for input before the next slice.
+					glfwPostEmptyEvent();
+				}
+
+				changedCurveRange = slicedTessellator.takeChangedRange();
+				++sceneVersion;
+			}
+		} else {
+			slicedControlPointsVersion = controlPointsVersion - 1;
+		}
+
+		if (isCurveEvaluatedInBackground) {
+			if (submittedControlPointsVersion != controlPointsVersion || submittedCurveSettingsVersion != curveSettingsVersion) {
+				submitTessellationRequest();
+
+				submittedControlPointsVersion = controlPointsVersion;
+				submittedCurveSettingsVersion = curveSettingsVersion;
+			}
+
+			if (tessellationWorker.fetchResult()) {
+				const TessellationResult& result = tessellationWorker.getResult();
+
+				// Results skipped by the triple buffer changed more than the range
+				// of the last one.
+				if (result.sequence == uploadedResultSequence + 1) {
+					changedCurveRange = result.changedRange;
+				} else {
+					changedCurveRange = { 0, result.vertices.size() };
+				}
+
+				uploadedResultSequence = result.sequence;
+				++sceneVersion;
+			}
+		} else {
+			// Resubmit once the background evaluation is turned back on.
+			submittedControlPointsVersion = controlPointsVersion - 1;
+		}
+
+		const bool isAnimating = currentTime - lastSceneChangeTime < ANIMATION_DURATION;
+
+		if (isRedrawOnDemand && sceneVersion == drawnSceneVersion && !isAnimating) {
+			frameProfiler.discardFrame();
+			continue;
+		}
+
+		drawnSceneVersion = sceneVersion;
 
 		glClearColor(0.329f, 0.431f, 0.478f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		if (controlPoints.size() >= MINIMUM_NUMBER_OF_CONTROL_POINTS) {
-			const mat4 coefficientMatrix = calculateCoefficientMatrix(tension, bias, continuity);
+		const vec2 *curveVertexData = nullptr;
+		size_t curveVertexCount = 0;
+
+		if (isCurveEvaluatedOnGpu) {
+			tessellationStatistics = AdaptiveTessellationStatistics();
+			tessellationStatistics.segmentCount = getSegmentCount(controlPoints.size());
+			tessellationStatistics.vertexCount = getTessellatedVertexCount(controlPoints.size(), STEPS_PER_SEGMENT);
+			tessellationStatistics.minimumSegmentVertexCount = STEPS_PER_SEGMENT;
+			tessellationStatistics.maximumSegmentVertexCount = STEPS_PER_SEGMENT;
+		} else if (isCurveEvaluatedInSlices) {
+			// Adaptive tessellation is not sliced; the curve is always uniform.
+			curveVertexData = slicedTessellator.getVertices();
+			curveVertexCount = slicedTessellator.getVertexCount();
+
+			tessellationStatistics = AdaptiveTessellationStatistics();
+			tessellationStatistics.segmentCount = getSegmentCount(controlPoints.size());
+			tessellationStatistics.vertexCount = curveVertexCount;
+			tessellationStatistics.minimumSegmentVertexCount = STEPS_PER_SEGMENT;
+			tessellationStatistics.maximumSegmentVertexCount = STEPS_PER_SEGMENT;
+		} else if (isCurveEvaluatedInBackground) {
+			// The latest finished result, which may lag behind the input.
+			const TessellationResult& result = tessellationWorker.getResult();
+
+			curveVertexData = result.vertices.data();
+			curveVertexCount = result.vertices.size();
+			tessellationStatistics = result.statistics;
+		} else if (controlPoints.size() >= MINIMUM_NUMBER_OF_CONTROL_POINTS) {
+			tessellateCurveForFrame(
+				basisTable.coefficientMatrix,
+				controlPoints,
+				curveVertexData,
+				curveVertexCount,
+				changedCurveRange
+			);
+		} else {
+			tessellationStatistics = AdaptiveTessellationStatistics();
+		}
 
-			drawCurve(coefficientMatrix, controlPoints);
+		const std::string statisticsCaption = formatTessellationStatistics(tessellationStatistics);
+		if (statisticsLabel->caption() != statisticsCaption) {
+			statisticsLabel->setCaption(statisticsCaption);
 		}
 
-		if (isDrawControlPolygon) {
-			drawControlPolygon(controlPoints);
+		frameProfiler.endStage(FrameStage::Tessellation);
+
+		if (isRetainedModeRendering) {
+			int frameBufferWidth, frameBufferHeight;
+			glfwGetFramebufferSize(window, &frameBufferWidth, &frameBufferHeight);
+			curveRenderer.setFrameBufferSize(frameBufferWidth, frameBufferHeight);
+
+			if (uploadedControlPointsVersion != controlPointsVersion) {
+				curveRenderer.uploadControlPoints(controlPoints.data(), controlPoints.size());
+				uploadedControlPointsVersion = controlPointsVersion;
+			}
+
+			if (isCurveEvaluatedOnGpu) {
+				if (uploadedControlPointTextureVersion != controlPointsVersion) {
+					curveRenderer.uploadControlPointTexture(controlPoints.data(), controlPoints.size());
+					uploadedControlPointTextureVersion = controlPointsVersion;
+				}
+
+				curveRenderer.drawGpuCurve(basisTable.coefficientMatrix, STEPS_PER_SEGMENT);
+			} else {
+				curveRenderer.uploadCurve(curveVertexData, curveVertexCount, changedCurveRange);
+				curveRenderer.drawCurve();
+			}
+
+			frameProfiler.endStage(FrameStage::Curve);
+
+			if (isDrawControlPolygon) {
+				curveRenderer.drawControlPolygon();
+			}
+
+			frameProfiler.endStage(FrameStage::ControlPolygon);
+
+			if (isDrawControlPoints) {
+				curveRenderer.drawControlPoints();
+			}
+
+			frameProfiler.endStage(FrameStage::ControlPoints);
+		} else {
+			// The buffers miss every change made while they are bypassed.
+			curveRenderer.invalidate();
+			uploadedControlPointsVersion = controlPointsVersion - 1;
+
+			drawCurve(curveVertexData, curveVertexCount);
+
+			frameProfiler.endStage(FrameStage::Curve);
+
+			if (isDrawControlPolygon) {
+				drawControlPolygon(controlPoints);
+			}
+
+			frameProfiler.endStage(FrameStage::ControlPolygon);
+
+			if (isDrawControlPoints) {
+				drawControlPoints(controlPoints);
+			}
+
+			frameProfiler.endStage(FrameStage::ControlPoints);
 		}
 
-		if (isDrawControlPoints) {
-			drawControlPoints(controlPoints);
+		if (frameProfiler.isEnabled()) {
+			// Shows the frames up to the previous one.
+			const std::vector<float> frameTimes = frameProfiler.getFrameTimeHistory();
+
+			nanogui::VectorXf graphValues(frameTimes.size());
+			for (size_t i = 0; i < frameTimes.size(); ++i) {
+				graphValues[i] = std::min(frameTimes[i] / FRAME_TIME_GRAPH_RANGE, 1.0f);
+			}
+
+			frameTimeGraph->setValues(graphValues);
+			char lastFrameTime[32] = "";
+			if (!frameTimes.empty()) {
+				snprintf(lastFrameTime, sizeof(lastFrameTime), "%.2f ms", frameTimes.back());
+			}
+
+			frameTimeGraph->setHeader(lastFrameTime);
+			frameTimeGraph->setFooter(formatFrameTimeStatistics(frameProfiler.getFrameStatistics()));
+
+			for (size_t stage = 0; stage < FRAME_STAGE_COUNT; ++stage) {
+				stageLabels[stage]->setCaption(
+					std::string(getFrameStageName((FrameStage)stage)) + ": " +
+					formatFrameTimeStatistics(frameProfiler.getStageStatistics((FrameStage)stage))
+				);
+			}
+
+			drawnVertexCountLabel->setCaption("Curve vertices: " + std::to_string(
+				isCurveEvaluatedOnGpu ? tessellationStatistics.vertexCount : curveVertexCount
+			));
 		}
 
 		// Draw NanoGUI.
 		screen->drawContents();
 		screen->drawWidgets();
 
+		frameProfiler.endStage(FrameStage::Widgets);
+
 		glfwSwapBuffers(window);
+
+		frameProfiler.endStage(FrameStage::Swap);
+		frameProfiler.endFrame();
+
+		++drawnFrameCount;
+	}
+
+	if (replayPath != nullptr) {
+		const FrameTimeStatistics frameStatistics = frameProfiler.getFrameStatistics();
+
+		std::cout << "Replayed " << inputPlayer.getFrameCount() << " input frames in "
+			<< glfwGetTime() - replayStartTime << " s, " << drawnFrameCount << " frames drawn ("
+			<< formatFrameTimeStatistics(frameStatistics) << ")" << std::endl;
+	}
+
+	inputRecorder.close();
+
+	curveRenderer.free();
+	slicedTessellator.free();
+	pointLoader.stop();
+	tessellationWorker.stop();
+	destroyTessellationThreadPool(tessellationThreadPool);
+
+	// Every recording thread has stopped by now.
+	if (tracePath != nullptr && !writeTrace(tracePath)) {
+		std::cerr << "Failed to write the trace to " << tracePath << std::endl;
 	}
 
 	glfwTerminate();
@@ -208,126 +964,352 @@ GLFWwindow *createWindow() {
 }
 
 void setupInputCallbacks(GLFWwindow * const window) {
-	glfwSetCursorPosCallback(window, onMouseMove);
+	// Every recorded callback is ignored during a replay, only the log drives
+	// the scene then.
+	glfwSetCursorPosCallback(window,
+		[](GLFWwindow *window, double x, double y) {
+			if (inputPlayer.isReplaying()) {
+				return;
+			}
+
+			const FrameEventScope eventScope(frameProfiler);
+
+			inputRecorder.record({ InputEventType::CursorPosition, glfwGetTime(), { 0, 0, 0, 0 }, x, y });
+			onMouseMove(window, x, y);
+		}
+	);
+
+	glfwSetMouseButtonCallback(window,
+		[](GLFWwindow *window, int button, int action, int modifiers) {
+			if (inputPlayer.isReplaying()) {
+				return;
+			}
 
-	glfwSetMouseButtonCallback(window, onMouseClick);
+			const FrameEventScope eventScope(frameProfiler);
+
+			inputRecorder.record({ InputEventType::MouseButton, glfwGetTime(), { button, action, modifiers, 0 }, 0.0, 0.0 });
+			onMouseClick(window, button, action, modifiers);
+		}
+	);
 
 	glfwSetKeyCallback(window,
-		[](GLFWwindow *, int key, int scancode, int action, int mods) {
-			screen->keyCallbackEvent(key, scancode, action, mods);
+		[](GLFWwindow *window, int key, int scancode, int action, int modifiers) {
+			if (inputPlayer.isReplaying()) {
+				return;
+			}
+
+			const FrameEventScope eventScope(frameProfiler);
+
+			inputRecorder.record({ InputEventType::Key, glfwGetTime(), { key, scancode, action, modifiers }, 0.0, 0.0 });
+			onKey(window, key, scancode, action, modifiers);
 		}
 	);
 
 	glfwSetCharCallback(window,
-		[](GLFWwindow *, unsigned int codepoint) {
-			screen->charCallbackEvent(codepoint);
+		[](GLFWwindow *window, unsigned int codepoint) {
+			if (inputPlayer.isReplaying()) {
+				return;
+			}
+
+			const FrameEventScope eventScope(frameProfiler);
+
+			inputRecorder.record({ InputEventType::Character, glfwGetTime(), { (int32_t)codepoint, 0, 0, 0 }, 0.0, 0.0 });
+			onCharacter(window, codepoint);
 		}
 	);
 
 	glfwSetDropCallback(window,
-		[](GLFWwindow *, int count, const char **filenames) {
-			screen->dropCallbackEvent(count, filenames);
+		[](GLFWwindow *window, int count, const char **filenames) {
+			const FrameEventScope eventScope(frameProfiler);
+
+			onDrop(window, count, filenames);
 		}
 	);
 
 	glfwSetScrollCallback(window,
-		[](GLFWwindow *, double x, double y) {
-			screen->scrollCallbackEvent(x, y);
+		[](GLFWwindow *window, double x, double y) {
+			if (inputPlayer.isReplaying()) {
+				return;
+			}
+
+			const FrameEventScope eventScope(frameProfiler);
+
+			inputRecorder.record({ InputEventType::Scroll, glfwGetTime(), { 0, 0, 0, 0 }, x, y });
+			onScroll(window, x, y);
 		}
 	);
 
+	// During a replay the recorded resizes set the window size instead.
 	glfwSetFramebufferSizeCallback(window,
-		[](GLFWwindow *, int width, int height) {
-			screen->resizeCallbackEvent(width, height);
+		[](GLFWwindow *window, int width, int height) {
+			if (inputPlayer.isReplaying()) {
+				return;
+			}
+
+			const FrameEventScope eventScope(frameProfiler);
+
+			inputRecorder.record({ InputEventType::FrameBufferSize, glfwGetTime(), { width, height, 0, 0 }, 0.0, 0.0 });
+			onFrameBufferResize(window, width, height);
+		}
+	);
+
+	glfwSetWindowRefreshCallback(window,
+		[](GLFWwindow *) {
+			invalidateScene();
 		}
 	);
 }
 
+void invalidateScene() {
+	++sceneVersion;
+	lastSceneChangeTime = glfwGetTime();
+}
+
+std::string formatTessellationStatistics(const AdaptiveTessellationStatistics& statistics) {
+	if (statistics.segmentCount == 0) {
+		return "Vertices: 0";
+	}
+
+	const float averageSegmentVertexCount =
+		(float)(statistics.vertexCount - 1) / (float)statistics.segmentCount;
+
+	char caption[128];
+	snprintf(caption, sizeof(caption), "Vertices: %zu (per segment %zu / %.1f / %zu, capped %zu)",
+		statistics.vertexCount,
+		statistics.minimumSegmentVertexCount,
+		averageSegmentVertexCount,
+		statistics.maximumSegmentVertexCount,
+		statistics.cappedSegmentCount
+	);
+
+	return caption;
+}
+
+std::string formatFrameTimeStatistics(const FrameTimeStatistics& statistics) {
+	char caption[128];
+	snprintf(caption, sizeof(caption), "min %.2f / avg %.2f / p99 %.2f ms",
+		statistics.minimum,
+		statistics.average,
+		statistics.percentile99
+	);
+
+	return std::string(caption);
+}
+
+std::string formatCpuUsage(const float continuousCpuUsage, const float onDemandCpuUsage) {
+	const auto formatValue = [](const float cpuUsage) {
+		if (cpuUsage < 0.0f) {
+			return std::string("-");
+		}
+
+		char value[32];
+		snprintf(value, sizeof(value), "%.1f %%", cpuUsage);
+
+		return std::string(value);
+	};
+
+	return "CPU: continuous " + formatValue(continuousCpuUsage) + ", on demand " + formatValue(onDemandCpuUsage);
+}
+
 void onMouseMove(GLFWwindow *window, double x, double y) {
+	KB_TRACE_SCOPE("onMouseMove");
+
+	cursorPosition = { (float)x, (float)y };
+
 	const bool isHandledByGui = screen->cursorPosCallbackEvent(x, y);
 
+	// Hover highlights in the GUI need a new frame as well.
+	invalidateScene();
+
 	if (isHandledByGui) {
-		draggedControlPoint = nullptr;
-	} else if (draggedControlPoint != nullptr) {
-		draggedControlPoint->x = (float)x;
-		draggedControlPoint->y = (float)y;
+		draggedControlPoint = NULL_SLOT_HANDLE;
+	} else if (controlPoints.contains(draggedControlPoint)) {
+		const size_t draggedIndex = controlPoints.indexOf(draggedControlPoint);
+		vec2& draggedPoint = controlPoints[draggedIndex];
+		const vec2 oldPosition = draggedPoint;
+
+		draggedPoint.x = (float)x;
+		draggedPoint.y = (float)y;
+
+		moveGridPoint(controlPointGrid, draggedIndex, oldPosition, draggedPoint);
+		invalidateControlPoint(curveCache, draggedIndex);
+		recordChange(controlPointChanges, { draggedIndex, 1 });
+		++controlPointsVersion;
 	}
 }
 
 void onMouseClick(GLFWwindow *window, int button, int action, int modifiers) {
+	KB_TRACE_SCOPE("onMouseClick");
+
 	const bool isHandledByGui = screen->mouseButtonCallbackEvent(button, action, modifiers);
 
+	invalidateScene();
+
 	if (!isHandledByGui && button == GLFW_MOUSE_BUTTON_LEFT) {
 
 		if (action == GLFW_PRESS) {
-			double xpos, ypos;
+			const SlotHandle pointUnderCursor = getClickedPoint(cursorPosition, controlPoints);
+
+			if (pointUnderCursor == NULL_SLOT_HANDLE) {
+				controlPoints.pushBack(cursorPosition);
 
-			glfwGetCursorPos(window, &xpos, &ypos);
+				insertGridPoint(controlPointGrid, controlPoints.size() - 1, cursorPosition);
 
-			const vec2 cursorPosition = { (float)xpos, (float)ypos };
+				invalidateControlPoint(curveCache, controlPoints.size() - 1);
+				recordChange(controlPointChanges, { controlPoints.size() - 1, 1 });
+				++controlPointsVersion;
+			}
+			else if (modifiers & GLFW_MOD_CONTROL) {
+				// Ctrl splits the curve: a copy of the point is inserted after
+				// it and dragged away, the original stays in place.
+				const size_t index = controlPoints.indexOf(pointUnderCursor) + 1;
 
-			vec2 *pointUnderCursor = getClickedPoint(cursorPosition, controlPoints);
+				insertControlPoint(index, cursorPosition);
 
-			if (pointUnderCursor == nullptr) {
-				controlPoints.push_back(cursorPosition);
+				draggedControlPoint = controlPoints.handleAt(index);
 			}
 			else {
 				draggedControlPoint = pointUnderCursor;
 			}
 		}
 		else if (action == GLFW_RELEASE) {
-			draggedControlPoint = nullptr;
+			draggedControlPoint = NULL_SLOT_HANDLE;
 		}
 	}
+	else if (!isHandledByGui && button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
+		eraseControlPoint(getClickedPoint(cursorPosition, controlPoints));
+	}
 }
 
-mat4 calculateCoefficientMatrix(const float tension, const float bias, const float continuity) {
-	const float s = 0.5f * (1.0f - tension);
-	const float q1 = s * (1.0f + bias) * (1.0f - continuity);
-	const float q2 = s * (1.0f - bias) * (1.0f + continuity);
-	const float q3 = s * (1.0f + bias) * (1.0f + continuity);
-	const float q4 = s * (1.0f - bias) * (1.0f - continuity);
-
-	return {
-		{ -q1, 2.0f * q1, -q1, 0 },
-		{ q1 - q2 - q3 + 2.0f, q3 - (2.0f * q1) + (2.0f * q2) - 3.0f, q1 - q2, 1.0f },
-		{ q2 + q3 - q4 - 2.0f, q4 - q3 - (2.0f * q2) + 3.0f, q2, 0 },
-		{ q4, -q4, 0, 0}
-	};
+void onKey(GLFWwindow *window, int key, int scancode, int action, int modifiers) {
+	screen->keyCallbackEvent(key, scancode, action, modifiers);
+	invalidateScene();
 }
 
-void drawCurve(const mat4& coefficientMatrix, const std::vector<vec2>& controlPoints) {
-	const size_t segmentCount = controlPoints.size() - 3;
+void onCharacter(GLFWwindow *window, unsigned int codepoint) {
+	screen->charCallbackEvent(codepoint);
+	invalidateScene();
+}
 
-	glLineWidth(2.5f);
-	glColor3ub(255, 171, 64);
-	glBegin(GL_LINE_STRIP);
-	for (size_t segmentIndex = 0; segmentIndex < segmentCount; ++segmentIndex) {
-		drawSegment(segmentIndex, coefficientMatrix, controlPoints);
-	}
-	glEnd();
+void onScroll(GLFWwindow *window, double x, double y) {
+	screen->scrollCallbackEvent(x, y);
+	invalidateScene();
 }
 
-void drawSegment(const size_t segmentIndex, const mat4& coefficientMatrix, const std::vector<vec2>& controlPoints) {
-	const mat24 geometry = {
-		controlPoints[segmentIndex + 0],
-		controlPoints[segmentIndex + 1],
-		controlPoints[segmentIndex + 2],
-		controlPoints[segmentIndex + 3]
-	};
+void onFrameBufferResize(GLFWwindow *window, int width, int height) {
+	screen->resizeCallbackEvent(width, height);
+	invalidateScene();
+}
 
-	const mat24 gm = geometry * coefficientMatrix;
+float getFrameBufferScale(GLFWwindow *window) {
+	int windowWidth, windowHeight, frameBufferWidth, frameBufferHeight;
+	glfwGetWindowSize(window, &windowWidth, &windowHeight);
+	glfwGetFramebufferSize(window, &frameBufferWidth, &frameBufferHeight);
 
-	for (float t = 0.0f; t <= 1.0f + PARAMETER_DELTA; t += PARAMETER_DELTA) {
-		const vec4 parameterVector = { t * t * t, t * t, t, 1.0f };
+	return windowWidth > 0 && frameBufferWidth > 0 ? (float)frameBufferWidth / (float)windowWidth : 1.0f;
+}
 
-		const vec2 curvePoint = gm * parameterVector;
+void onDrop(GLFWwindow *window, int count, const char **filenames) {
+	screen->dropCallbackEvent(count, filenames);
+	invalidateScene();
 
-		glVertex2f(curvePoint.x, curvePoint.y);
+	// Only one point set can be shown, the first dropped file wins.
+	if (count > 0) {
+		startLoadingControlPoints(filenames[0]);
 	}
 }
 
-void drawControlPolygon(const std::vector<vec2>& controlPoints) {
+void dispatchInputEvent(GLFWwindow *window, const InputEvent& event) {
+	switch (event.type) {
+	case InputEventType::CursorPosition:
+		onMouseMove(window, event.x, event.y);
+		break;
+	case InputEventType::MouseButton:
+		onMouseClick(window, event.values[0], event.values[1], event.values[2]);
+		break;
+	case InputEventType::Key:
+		onKey(window, event.values[0], event.values[1], event.values[2], event.values[3]);
+		break;
+	case InputEventType::Character:
+		onCharacter(window, (unsigned int)event.values[0]);
+		break;
+	case InputEventType::Scroll:
+		onScroll(window, event.x, event.y);
+		break;
+	case InputEventType::FrameBufferSize: {
+		// The window size is in screen coordinates, which differ from
+		// framebuffer pixels on high-DPI displays.
+		const float frameBufferScale = getFrameBufferScale(window);
+
+		glfwSetWindowSize(
+			window,
+			(int)std::lround(event.values[0] / frameBufferScale),
+			(int)std::lround(event.values[1] / frameBufferScale)
+		);
+
+		// The window system may resize later or not at all, the screen takes
+		// the recorded size right away.
+		onFrameBufferResize(window, event.values[0], event.values[1]);
+		break;
+	}
+	case InputEventType::FrameEnd:
+		break;
+	}
+}
+
+void tessellateCurveForFrame(
+	const mat4& coefficientMatrix,
+	const SlotMap<vec2>& controlPoints,
+	const vec2 *& vertices,
+	size_t& vertexCount,
+	VertexRange& changedRange
+) {
+	tessellationStatistics = AdaptiveTessellationStatistics();
+	tessellationStatistics.segmentCount = getSegmentCount(controlPoints.size());
+	tessellationStatistics.minimumSegmentVertexCount = STEPS_PER_SEGMENT;
+	tessellationStatistics.maximumSegmentVertexCount = STEPS_PER_SEGMENT;
+
+	if (isAdaptiveTessellation) {
+		// Adaptive spans change length with every edit, so they are not cached.
+		vertexCount = tessellateCurveAdaptive(
+			controlPoints.data(),
+			controlPoints.size(),
+			coefficientMatrix,
+			FLATNESS_TOLERANCE,
+			MAXIMUM_VERTICES_PER_SEGMENT,
+			curveVertices,
+			&tessellationStatistics
+		);
+		vertices = curveVertices.data();
+		changedRange = { 0, vertexCount };
+	} else {
+		changedRange = updateCurveCache(
+			curveCache,
+			controlPoints.data(),
+			controlPoints.size(),
+			basisTable,
+			tessellationMethod,
+			tessellationThreadPool
+		);
+
+		vertexCount = curveCache.vertices.size();
+		vertices = curveCache.vertices.data();
+	}
+
+	tessellationStatistics.vertexCount = vertexCount;
+}
+
+void drawCurve(const vec2 *vertices, const size_t vertexCount) {
+	glLineWidth(2.5f);
+	glColor3ub(255, 171, 64);
+	glBegin(GL_LINE_STRIP);
+	for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+		glVertex2f(vertices[vertexIndex].x, vertices[vertexIndex].y);
+	}
+	glEnd();
+}
+
+void drawControlPolygon(const SlotMap<vec2>& controlPoints) {
 	glLineWidth(1.5f);
 	glColor3ub(255, 255, 255);
 	glBegin(GL_LINE_STRIP);
@@ -337,7 +1319,7 @@ void drawControlPolygon(const std::vector<vec2>& controlPoints) {
 	glEnd();
 }
 
-void drawControlPoints(const std::vector<vec2>& controlPoints) {
+void drawControlPoints(const SlotMap<vec2>& controlPoints) {
 	glColor3ub(255, 255, 255);
 	glBegin(GL_POINTS);
 	for (const auto& point : controlPoints) {
@@ -346,15 +1328,238 @@ void drawControlPoints(const std::vector<vec2>& controlPoints) {
 	glEnd();
 }
 
-vec2 *getClickedPoint(const vec2& cursorPosition, std::vector<vec2>& controlPoints)
+SlotHandle getClickedPoint(const vec2& cursorPosition, const SlotMap<vec2>& controlPoints)
 {
-	const auto clickedIterator = std::find_if(controlPoints.begin(), controlPoints.end(), [&cursorPosition](const vec2& point) {
-		return dist2(cursorPosition, point) <= CLICK_THRESHOLD;
-	});
+	const size_t clickedIndex = findGridPoint(controlPointGrid, controlPoints.data(), cursorPosition, CLICK_THRESHOLD);
 
-	if (clickedIterator == controlPoints.end()) {
-		return nullptr;
+	if (clickedIndex == NO_GRID_POINT) {
+		return NULL_SLOT_HANDLE;
 	} else {
-		return &(*clickedIterator);
+		return controlPoints.handleAt(clickedIndex);
+	}
+}
+
+// Inserting or erasing in the middle shifts every later point, so their grid
+// entries are renumbered and the curve is re-evaluated from the first segment
+// using the point onward.
+void insertControlPoint(const size_t index, const vec2& position)
+{
+	controlPoints.insert(index, position);
+
+	insertShiftedGridPoint(controlPointGrid, controlPoints.data(), controlPoints.size(), index);
+	invalidateControlPointsFrom(curveCache, index);
+	recordChange(controlPointChanges, { index, controlPoints.size() - index });
+	++controlPointsVersion;
+}
+
+void eraseControlPoint(const SlotHandle handle)
+{
+	if (!controlPoints.contains(handle)) {
+		return;
+	}
+
+	const size_t index = controlPoints.indexOf(handle);
+	const vec2 position = controlPoints[index];
+	controlPoints.erase(handle);
+
+	eraseShiftedGridPoint(controlPointGrid, controlPoints.data(), controlPoints.size(), index, position);
+	invalidateControlPointsFrom(curveCache, index);
+	recordChange(controlPointChanges, { index, controlPoints.size() - index });
+	++controlPointsVersion;
+}
+
+void startLoadingControlPoints(const std::string& path) {
+	const bool isStarted = pointLoader.start(path, tessellationThreadPool, sqrtf(CLICK_THRESHOLD), []() {
+		// Wakes up glfwWaitEventsTimeout() to show the progress.
+		glfwPostEmptyEvent();
+	}, isSingleThreaded);
+
+	if (!isStarted) {
+		std::cerr << "Still loading, ignoring " << path << std::endl;
+	}
+}
+
+void swapInLoadedPoints(LoadedPoints& loadedPoints) {
+	KB_TRACE_SCOPE("swapInLoadedPoints");
+
+	// Handles of the old points mean nothing in the new map.
+	draggedControlPoint = NULL_SLOT_HANDLE;
+
+	std::swap(controlPoints, loadedPoints.controlPoints);
+	std::swap(controlPointGrid, loadedPoints.grid);
+
+	if (loadedPoints.hasCurveSettings) {
+		tension = loadedPoints.tension;
+		bias = loadedPoints.bias;
+		continuity = loadedPoints.continuity;
+		++curveSettingsVersion;
+	}
+
+	invalidateCurveCache(curveCache);
+	recordFullChange(controlPointChanges);
+	++controlPointsVersion;
+	invalidateScene();
+}
+
+bool saveControlPoints(const char *path) {
+	return writePointFile(path, controlPoints.data(), controlPoints.size(), tension, bias, continuity);
+}
+
+bool exportCurveFile(const std::string& path) {
+	const bool isPointFile = path.size() >= 4 && path.compare(path.size() - 4, 4, ".kbp") == 0;
+
+	FILE *output = fopen(path.c_str(), "wb");
+
+	if (output == nullptr) {
+		return false;
+	}
+
+	CurveExportStatistics statistics;
+
+	const bool isExported = exportCurve(
+		output,
+		isPointFile ? CurveExportFormat::PointFile : CurveExportFormat::SvgBezier,
+		tessellationThreadPool,
+		controlPoints.data(),
+		controlPoints.size(),
+		basisTable,
+		tessellationMethod,
+		&statistics
+	);
+
+	if (fclose(output) != 0 || !isExported) {
+		return false;
+	}
+
+	std::cout << "Exported " << statistics.segmentCount << " segments, " << statistics.byteCount << " bytes in "
+		<< statistics.seconds * 1000.0 << " ms" << std::endl;
+
+	return true;
+}
+
+bool importControlPoints(const char *path) {
+	const bool isStandardInput = strcmp(path, "-") == 0;
+	FILE *input = isStandardInput ? stdin : fopen(path, "rb");
+
+	if (input == nullptr) {
+		return false;
+	}
+
+	// Parsed into a separate buffer, so that a failed import keeps the current
+	// points. Only one block of text is held at a time; the buffer is
+	// allocated once for a file, and grows as a pipe is read.
+	std::vector<vec2> importedPoints;
+	PointImportStatistics statistics;
+
+	const bool isImported = importPointText(input, tessellationThreadPool, importedPoints, statistics);
+
+	if (!isStandardInput) {
+		fclose(input);
+	}
+
+	if (!isImported) {
+		return false;
+	}
+
+	// Takes over the buffer, the points are not copied again.
+	controlPoints.assign(std::move(importedPoints));
+
+	std::cout << "Imported " << statistics.pointCount << " points from " << statistics.byteCount / 1e6 << " MB ("
+		<< statistics.rejectedLineCount << " lines rejected) in " << statistics.seconds << " s, "
+		<< getImportThroughput(statistics) << " MB/s" << std::endl;
+
+	resetControlPointState();
+
+	return true;
+}
+
+void resetControlPointState() {
+	draggedControlPoint = NULL_SLOT_HANDLE;
+
+	buildPointGrid(controlPointGrid, sqrtf(CLICK_THRESHOLD), controlPoints.data(), controlPoints.size());
+	invalidateCurveCache(curveCache);
+	recordFullChange(controlPointChanges);
+	++controlPointsVersion;
+	invalidateScene();
+}
+
+void submitTessellationRequest() {
+	TessellationRequest& request = tessellationWorker.getRequestBuffer();
+
+	updateCopy(
+		request.controlPoints,
+		request.controlPointChanges.version,
+		controlPointChanges,
+		controlPoints.data(),
+		controlPoints.size()
+	);
+	request.controlPointChanges = controlPointChanges;
+	request.basisTable = basisTable;
+	request.method = tessellationMethod;
+	request.isAdaptive = isAdaptiveTessellation;
+	request.flatnessTolerance = FLATNESS_TOLERANCE;
+	request.maximumVerticesPerSegment = MAXIMUM_VERTICES_PER_SEGMENT;
+
+	tessellationWorker.submitRequest();
+}
+
+// Prints the time of a full curve evaluation with 1 .. maximumThreadCount
+// threads for every method, and the speedup over a single thread.
+void reportThreadScaling(const size_t maximumThreadCount) {
+	const size_t CONTROL_POINT_COUNT = 1000000;
+	const int RUN_COUNT = 5;
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> coordinate(0.0f, 800.0f);
+
+	std::vector<vec2> points(CONTROL_POINT_COUNT);
+
+	for (auto& point : points) {
+		point = { coordinate(random), coordinate(random) };
+	}
+
+	BasisTable table;
+	updateBasisTable(table, 0.0f, 0.0f, 0.0f, STEPS_PER_SEGMENT);
+
+	std::vector<vec2> vertices(getTessellatedVertexCount(points.size(), STEPS_PER_SEGMENT));
+
+	const char *methodNames[] = { "Matrix", "Forward differencing", "SIMD", "Basis table" };
+	const TessellationMethod methods[] = {
+		TessellationMethod::Matrix,
+		TessellationMethod::ForwardDifferencing,
+		TessellationMethod::Simd,
+		TessellationMethod::BasisTable
+	};
+
+	printf("%zu control points, %zu steps per segment, best of %d runs\n",
+		points.size(), STEPS_PER_SEGMENT, RUN_COUNT);
+
+	for (size_t methodIndex = 0; methodIndex < 4; ++methodIndex) {
+		printf("\n%s\n", methodNames[methodIndex]);
+
+		double singleThreadTime = 0.0;
+
+		for (size_t threadCount = 1; threadCount <= maximumThreadCount; ++threadCount) {
+			TessellationThreadPool *pool = createTessellationThreadPool(threadCount);
+
+			double bestTime = 1e30;
+
+			for (int run = 0; run < RUN_COUNT; ++run) {
+				const auto start = std::chrono::steady_clock::now();
+
+				tessellateCurveParallel(pool, points.data(), points.size(), table, methods[methodIndex], vertices.data());
+
+				const std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+				bestTime = std::min(bestTime, time.count());
+			}
+
+			destroyTessellationThreadPool(pool);
+
+			if (threadCount == 1) {
+				singleThreadTime = bestTime;
+			}
+
+			printf("  %2zu threads: %8.2f ms, speedup %.2fx\n", threadCount, bestTime, singleThreadTime / bestTime);
+		}
 	}
 }
@@ -0,0 +1,148 @@
+#include "point_loader.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <filesystem>
+
+#include "kb_point_file.h"
+#include "kb_point_import.h"
+#include "kb_trace.h"
+
+namespace {
+
+// The mapped points are copied in slices, to report progress in between;
+// the copy is what actually reads the file.
+const size_t COPY_SLICE_SIZE = 1 << 20;
+
+// Reading takes this part of the progress bar, building the grid the rest.
+const float READ_PROGRESS = 0.9f;
+
+bool isPointFile(const std::string& path) {
+	return path.size() >= 4 && path.compare(path.size() - 4, 4, ".kbp") == 0;
+}
+
+}
+
+PointLoader::~PointLoader() {
+	stop();
+}
+
+bool PointLoader::start(
+	const std::string& path,
+	TessellationThreadPool *pool,
+	const float gridCellSize,
+	const std::function<void()>& onProgress,
+	const bool isOnCallingThread
+) {
+	if (isLoading()) {
+		return false;
+	}
+
+	// A finished but unfetched load is dropped.
+	stop();
+
+	mResult = LoadedPoints();
+	mResult.path = path;
+	mProgress.store(0.0f, std::memory_order_relaxed);
+	mIsFinished.store(false, std::memory_order_relaxed);
+	mIsResultPending = true;
+
+	if (isOnCallingThread) {
+		load(pool, gridCellSize, onProgress);
+	} else {
+		mThread = std::thread([this, pool, gridCellSize, onProgress]() {
+			setTraceThreadName("Point loader");
+			load(pool, gridCellSize, onProgress);
+		});
+	}
+
+	return true;
+}
+
+bool PointLoader::fetchResult(LoadedPoints& result) {
+	if (!mIsResultPending || !mIsFinished.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	if (mThread.joinable()) {
+		mThread.join();
+	}
+
+	mIsResultPending = false;
+	result = std::move(mResult);
+
+	return true;
+}
+
+void PointLoader::stop() {
+	if (mThread.joinable()) {
+		mThread.join();
+	}
+}
+
+void PointLoader::load(TessellationThreadPool *pool, const float gridCellSize, const std::function<void()>& onProgress) {
+	KB_TRACE_SCOPE("Load points");
+
+	LoadedPoints& result = mResult;
+
+	if (isPointFile(result.path)) {
+		MappedPointFile file;
+
+		if (openPointFile(file, result.path.c_str())) {
+			result.controlPoints.reserve(file.pointCount);
+
+			for (size_t first = 0; first < file.pointCount; first += COPY_SLICE_SIZE) {
+				const size_t count = std::min(COPY_SLICE_SIZE, file.pointCount - first);
+
+				result.controlPoints.append(file.points + first, count);
+				setProgress(READ_PROGRESS * (float)(first + count) / (float)file.pointCount, onProgress);
+			}
+
+			result.hasCurveSettings = true;
+			result.tension = file.tension;
+			result.bias = file.bias;
+			result.continuity = file.continuity;
+			result.isLoaded = true;
+
+			closePointFile(file);
+		}
+	} else {
+		FILE *input = fopen(result.path.c_str(), "rb");
+
+		if (input != nullptr) {
+			std::error_code error;
+			const double fileSize = (double)std::max<uintmax_t>(std::filesystem::file_size(result.path, error), 1);
+
+			PointImportStatistics statistics;
+
+			result.isLoaded = streamPointText(input, pool, [&](const vec2 *points, size_t pointCount) {
+				result.controlPoints.append(points, pointCount);
+				setProgress(READ_PROGRESS * (float)std::min((double)statistics.byteCount / fileSize, 1.0), onProgress);
+			}, statistics);
+
+			fclose(input);
+		}
+	}
+
+	if (result.isLoaded) {
+		KB_TRACE_SCOPE("Build point grid");
+
+		buildPointGrid(result.grid, gridCellSize, result.controlPoints.data(), result.controlPoints.size());
+	}
+
+	mProgress.store(1.0f, std::memory_order_relaxed);
+	mIsFinished.store(true, std::memory_order_release);
+
+	onProgress();
+}
+
+void PointLoader::setProgress(const float progress, const std::function<void()>& onProgress) {
+	// Whole percents only, every update costs the render thread a frame.
+	if ((int)(progress * 100.0f) == (int)(getProgress() * 100.0f)) {
+		return;
+	}
+
+	mProgress.store(progress, std::memory_order_relaxed);
+	onProgress();
+}
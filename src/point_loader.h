@@ -0,0 +1,74 @@
+#ifndef H___POINT_LOADER
+#define H___POINT_LOADER
+
+#include <stddef.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "bevgrafmath2017.h"
+#include "kb_parallel.h"
+#include "kb_point_grid.h"
+#include "kb_slot_map.h"
+
+// A point set ready to be swapped into the scene.
+struct LoadedPoints {
+	std::string path;
+	bool isLoaded = false;
+
+	SlotMap<vec2> controlPoints;
+	PointGrid grid;
+
+	// Only point files (.kbp) store the curve settings.
+	bool hasCurveSettings = false;
+	float tension = 0.0f;
+	float bias = 0.0f;
+	float continuity = 0.0f;
+};
+
+// Loads a point file (.kbp) or a CSV / text file on its own thread, and
+// builds everything the scene needs from it, so that the render thread only
+// has to swap the result in. Without threads, the file is loaded by start()
+// on the calling thread instead.
+class PointLoader {
+public:
+	~PointLoader();
+
+	// Fails while another file is loading. onProgress is called on the
+	// loading thread whenever the progress changes and when it finishes.
+	bool start(
+		const std::string& path,
+		TessellationThreadPool *pool,
+		const float gridCellSize,
+		const std::function<void()>& onProgress,
+		const bool isOnCallingThread = false
+	);
+
+	bool isLoading() const { return mIsResultPending && !mIsFinished.load(std::memory_order_acquire); }
+
+	// From 0 to 1.
+	float getProgress() const { return mProgress.load(std::memory_order_relaxed); }
+
+	// Moves the result out once the load has finished, failed or not.
+	bool fetchResult(LoadedPoints& result);
+
+	// Waits for a running load; there is no way to cancel one.
+	void stop();
+
+private:
+	void load(TessellationThreadPool *pool, const float gridCellSize, const std::function<void()>& onProgress);
+	void setProgress(const float progress, const std::function<void()>& onProgress);
+
+	std::thread mThread;
+	std::atomic<bool> mIsFinished{ false };
+	std::atomic<float> mProgress{ 0.0f };
+	// Started but not fetched yet.
+	bool mIsResultPending = false;
+
+	// Owned by the loading thread until mIsFinished is set.
+	LoadedPoints mResult;
+};
+
+#endif // !H___POINT_LOADER
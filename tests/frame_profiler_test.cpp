@@ -0,0 +1,76 @@
+/*
+	Tests of the frame profiler. Exits with 1 if a check fails.
+*/
+
+#include <stdio.h>
+
+#include "frame_profiler.h"
+
+namespace {
+
+int failedCheckCount = 0;
+
+void check(const bool isPassed, const char *description) {
+	if (!isPassed) {
+		fprintf(stderr, "FAILED: %s\n", description);
+		++failedCheckCount;
+	}
+}
+
+// 5 ms of input callbacks.
+const uint64_t EVENT_TIME = 5000000;
+
+void testEventTimeBetweenFrames() {
+	FrameProfiler profiler;
+	profiler.setEnabled(true);
+
+	profiler.beginFrame();
+	profiler.addEventTime(0, EVENT_TIME);
+	profiler.endStage(FrameStage::Events);
+	profiler.endFrame();
+
+	check(profiler.getStageStatistics(FrameStage::Events).average < 5.0f, "callbacks inside a frame are not counted twice");
+
+	profiler.addEventTime(0, EVENT_TIME);
+	profiler.beginFrame();
+	profiler.endStage(FrameStage::Events);
+	profiler.endFrame();
+
+	check(profiler.getStageStatistics(FrameStage::Events).minimum >= 0.0f, "the Events stage is not negative");
+	check(profiler.getStageStatistics(FrameStage::Events).percentile99 >= 5.0f, "callbacks between frames are added to the Events stage");
+	check(profiler.getFrameStatistics().percentile99 >= 5.0f, "callbacks between frames are added to the frame time");
+}
+
+void testEventTimeAfterSkippedFrame() {
+	FrameProfiler profiler;
+	profiler.setEnabled(true);
+
+	// Nothing changed, the frame is skipped.
+	profiler.beginFrame();
+	profiler.endStage(FrameStage::Events);
+	profiler.discardFrame();
+
+	check(profiler.getFrameCount() == 0, "a discarded frame is not recorded");
+
+	profiler.addEventTime(0, EVENT_TIME);
+
+	profiler.beginFrame();
+	profiler.endStage(FrameStage::Events);
+	profiler.endFrame();
+
+	check(profiler.getFrameCount() == 1, "the frame after a discarded one is recorded");
+	check(profiler.getStageStatistics(FrameStage::Events).average >= 5.0f, "callbacks after a skipped frame are added to the Events stage");
+}
+
+}
+
+int main() {
+	testEventTimeBetweenFrames();
+	testEventTimeAfterSkippedFrame();
+
+	if (failedCheckCount == 0) {
+		printf("All frame profiler checks passed\n");
+	}
+
+	return failedCheckCount == 0 ? 0 : 1;
+}
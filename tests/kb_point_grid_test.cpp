@@ -0,0 +1,84 @@
+/*
+	Tests of the uniform point grid. Exits with 1 if a check fails.
+*/
+
+#include <stdio.h>
+
+#include "kb_point_grid.h"
+
+namespace {
+
+int failedCheckCount = 0;
+
+void check(const bool isPassed, const char *description) {
+	if (!isPassed) {
+		fprintf(stderr, "FAILED: %s\n", description);
+		++failedCheckCount;
+	}
+}
+
+void testNearestPointWins() {
+	// Both points are within the radius; the later one is nearer.
+	const vec2 points[] = {
+		{ 10.0f, 10.0f },
+		{ 14.0f, 10.0f }
+	};
+
+	PointGrid grid;
+	buildPointGrid(grid, 5.0f, points, 2);
+
+	check(findGridPoint(grid, points, { 13.0f, 10.0f }, 25.0f) == 1, "the nearer point with the higher index is found");
+	check(findGridPoint(grid, points, { 11.0f, 10.0f }, 25.0f) == 0, "the nearer point with the lower index is found");
+}
+
+void testNearestPointAcrossCells() {
+	// The query is next to a cell boundary, the nearest point is across it.
+	const vec2 points[] = {
+		{ 1.0f, 1.0f },
+		{ 5.5f, 1.0f }
+	};
+
+	PointGrid grid;
+	buildPointGrid(grid, 5.0f, points, 2);
+
+	check(findGridPoint(grid, points, { 4.5f, 1.0f }, 25.0f) == 1, "the nearest point in a neighbouring cell is found");
+}
+
+void testEqualDistances() {
+	const vec2 points[] = {
+		{ 12.0f, 10.0f },
+		{ 8.0f, 10.0f }
+	};
+
+	PointGrid grid;
+	buildPointGrid(grid, 5.0f, points, 2);
+
+	check(findGridPoint(grid, points, { 10.0f, 10.0f }, 25.0f) == 0, "equally near points go to the lower index");
+}
+
+void testRadius() {
+	const vec2 points[] = {
+		{ 10.0f, 10.0f }
+	};
+
+	PointGrid grid;
+	buildPointGrid(grid, 5.0f, points, 1);
+
+	check(findGridPoint(grid, points, { 13.0f, 14.0f }, 25.0f) == 0, "a point exactly at the radius is found");
+	check(findGridPoint(grid, points, { 13.0f, 14.1f }, 25.0f) == NO_GRID_POINT, "a point outside the radius is not found");
+}
+
+}
+
+int main() {
+	testNearestPointWins();
+	testNearestPointAcrossCells();
+	testEqualDistances();
+	testRadius();
+
+	if (failedCheckCount == 0) {
+		printf("All point grid checks passed\n");
+	}
+
+	return failedCheckCount == 0 ? 0 : 1;
+}
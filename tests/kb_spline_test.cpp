@@ -0,0 +1,194 @@
+/*
+	Tests of the tessellation methods against the Matrix method. Exits with 1
+	if a check fails.
+*/
+
+#include <math.h>
+#include <stdio.h>
+
+#include <random>
+#include <vector>
+
+#include "kb_spline.h"
+
+namespace {
+
+int failedCheckCount = 0;
+
+void check(const bool isPassed, const char *description) {
+	if (!isPassed) {
+		fprintf(stderr, "FAILED: %s\n", description);
+		++failedCheckCount;
+	}
+}
+
+const size_t STEPS_PER_SEGMENT = 20;
+
+// Pixels; window-sized coordinates stay well within this for every method
+// that only differs from Matrix by rounding.
+const float ROUNDING_TOLERANCE = 2e-3f;
+
+// Written past the end of the curve, so that writing too much shows.
+const vec2 GUARD = { -12345.0f, 54321.0f };
+
+struct Parameters {
+	float tension;
+	float bias;
+	float continuity;
+};
+
+const Parameters PARAMETER_SETS[] = {
+	{ 0.0f, 0.0f, 0.0f },
+	{ 0.5f, -0.3f, 0.2f },
+	{ -0.8f, 0.9f, -0.6f },
+	{ 1.0f, -1.0f, 1.0f }
+};
+
+std::vector<vec2> generatePoints(const size_t count, std::mt19937& random) {
+	std::uniform_real_distribution<float> coordinate(0.0f, 1024.0f);
+	std::vector<vec2> points(count);
+
+	for (vec2& point : points) {
+		point = { coordinate(random), coordinate(random) };
+	}
+
+	return points;
+}
+
+// The vertices of one method, followed by a guard vertex.
+std::vector<vec2> tessellate(const std::vector<vec2>& points, const BasisTable& basisTable, const TessellationMethod method, size_t& vertexCount) {
+	std::vector<vec2> vertices(getTessellatedVertexCount(points.size(), STEPS_PER_SEGMENT) + 1, GUARD);
+
+	if (method == TessellationMethod::BasisTable) {
+		vertexCount = tessellateCurve(points.data(), points.size(), basisTable, vertices.data());
+	} else {
+		vertexCount = tessellateCurve(
+			points.data(),
+			points.size(),
+			basisTable.coefficientMatrix,
+			STEPS_PER_SEGMENT,
+			vertices.data(),
+			method
+		);
+	}
+
+	return vertices;
+}
+
+float getMaximumDifference(const std::vector<vec2>& a, const std::vector<vec2>& b) {
+	float maximum = 0.0f;
+
+	for (size_t i = 0; i < a.size(); ++i) {
+		maximum = fmaxf(maximum, fmaxf(fabsf(a[i].x - b[i].x), fabsf(a[i].y - b[i].y)));
+	}
+
+	return maximum;
+}
+
+bool isIdentical(const std::vector<vec2>& a, const std::vector<vec2>& b) {
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a[i].x != b[i].x || a[i].y != b[i].y) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void compareMethods(const std::vector<vec2>& points, const Parameters& parameters) {
+	BasisTable basisTable;
+	updateBasisTable(basisTable, parameters.tension, parameters.bias, parameters.continuity, STEPS_PER_SEGMENT);
+
+	const size_t expectedVertexCount = getTessellatedVertexCount(points.size(), STEPS_PER_SEGMENT);
+
+	size_t matrixVertexCount;
+	const std::vector<vec2> matrixVertices = tessellate(points, basisTable, TessellationMethod::Matrix, matrixVertexCount);
+
+	check(matrixVertexCount == expectedVertexCount, "Matrix writes getTessellatedVertexCount() vertices");
+	check(matrixVertices.back().x == GUARD.x && matrixVertices.back().y == GUARD.y, "Matrix writes no further vertex");
+
+	size_t simdVertexCount;
+	const std::vector<vec2> simdVertices = tessellate(points, basisTable, TessellationMethod::Simd, simdVertexCount);
+
+	check(simdVertexCount == expectedVertexCount, "Simd writes as many vertices as Matrix");
+	check(isIdentical(simdVertices, matrixVertices), "Simd is bit-identical to Matrix");
+
+	size_t forwardVertexCount;
+	const std::vector<vec2> forwardVertices = tessellate(points, basisTable, TessellationMethod::ForwardDifferencing, forwardVertexCount);
+
+	check(forwardVertexCount == expectedVertexCount, "ForwardDifferencing writes as many vertices as Matrix");
+	check(getMaximumDifference(forwardVertices, matrixVertices) <= ROUNDING_TOLERANCE, "ForwardDifferencing stays within the tolerance of Matrix");
+
+	size_t tableVertexCount;
+	const std::vector<vec2> tableVertices = tessellate(points, basisTable, TessellationMethod::BasisTable, tableVertexCount);
+
+	check(tableVertexCount == expectedVertexCount, "BasisTable writes as many vertices as Matrix");
+	check(getMaximumDifference(tableVertices, matrixVertices) <= ROUNDING_TOLERANCE, "BasisTable stays within the tolerance of Matrix");
+
+	// Every instruction set the CPU supports, through the structure-of-arrays
+	// entry point.
+	std::vector<float> controlX(points.size()), controlY(points.size());
+
+	for (size_t i = 0; i < points.size(); ++i) {
+		controlX[i] = points[i].x;
+		controlY[i] = points[i].y;
+	}
+
+	for (int level = (int)SimdLevel::Scalar; level <= (int)getSupportedSimdLevel(); ++level) {
+		std::vector<float> outputX(expectedVertexCount + 1, GUARD.x), outputY(expectedVertexCount + 1, GUARD.y);
+
+		const size_t vertexCount = tessellateCurveSoA(
+			controlX.data(),
+			controlY.data(),
+			points.size(),
+			basisTable.coefficientMatrix,
+			STEPS_PER_SEGMENT,
+			outputX.data(),
+			outputY.data(),
+			(SimdLevel)level
+		);
+
+		std::vector<vec2> soaVertices(expectedVertexCount + 1);
+
+		for (size_t i = 0; i < soaVertices.size(); ++i) {
+			soaVertices[i] = { outputX[i], outputY[i] };
+		}
+
+		check(vertexCount == expectedVertexCount, "tessellateCurveSoA writes as many vertices as Matrix");
+		check(isIdentical(soaVertices, matrixVertices), "tessellateCurveSoA is bit-identical to Matrix at every level");
+	}
+}
+
+void testSmallPointCounts() {
+	std::mt19937 random(1);
+
+	for (const Parameters& parameters : PARAMETER_SETS) {
+		for (size_t pointCount = 0; pointCount <= 5; ++pointCount) {
+			compareMethods(generatePoints(pointCount, random), parameters);
+		}
+	}
+}
+
+void testLargePointSet() {
+	std::mt19937 random(2);
+
+	// Not a multiple of any vector width.
+	const std::vector<vec2> points = generatePoints(10007, random);
+
+	for (const Parameters& parameters : PARAMETER_SETS) {
+		compareMethods(points, parameters);
+	}
+}
+
+}
+
+int main() {
+	testSmallPointCounts();
+	testLargePointSet();
+
+	if (failedCheckCount == 0) {
+		printf("All tessellation checks passed\n");
+	}
+
+	return failedCheckCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+/*
+	Headless batch tessellation.
+
+	Tessellates every input file and streams the curve next to it (or into
+	--output-dir) as a polyline point file named <input>.polyline.kbp, or as
+	an SVG path of the polyline or of exact Bezier segments named <input>.svg.
+	Inputs are point files (.kbp), which are mapped and evaluated in place, or
+	CSV / text files.
+	The TCB parameters default to those stored in a point file, and to 0 for
+	text files; the command line overrides both.
+
+	With at least as many files as threads, the files are processed in
+	parallel, one per thread. Fewer, presumably larger files are processed one
+	after the other, each split across all threads. The evaluation never
+	nests, as a thread waiting for its own helpers inside a pool task could
+	starve the pool.
+
+	Usage: kb_batch [--tension T] [--bias B] [--continuity C] [--steps N]
+	                [--method matrix|forward|simd|table] [--threads N]
+	                [--format kbp|svg|svg-bezier] [--output-dir dir] [--quiet]
+	                input...
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "kb_curve_export.h"
+#include "kb_parallel.h"
+#include "kb_point_file.h"
+#include "kb_point_import.h"
+#include "kb_spline.h"
+
+namespace {
+
+struct BatchOptions {
+	// NaN: taken from the input.
+	float tension = NAN;
+	float bias = NAN;
+	float continuity = NAN;
+
+	size_t stepsPerSegment = 20;
+	TessellationMethod method = TessellationMethod::Simd;
+	size_t threadCount = getHardwareThreadCount();
+	CurveExportFormat format = CurveExportFormat::PointFile;
+	const char *outputDirectory = nullptr;
+	bool isQuiet = false;
+
+	std::vector<const char *> inputPaths;
+};
+
+struct FileResult {
+	bool isTessellated = false;
+	size_t controlPointCount = 0;
+	size_t writtenPointCount = 0;
+	size_t byteCount = 0;
+	double seconds = 0.0;
+};
+
+double getTime() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool isPointFile(const std::string& path) {
+	return path.size() >= 4 && path.compare(path.size() - 4, 4, ".kbp") == 0;
+}
+
+std::string getOutputPath(const char *inputPath, const BatchOptions& options) {
+	std::filesystem::path outputPath = inputPath;
+
+	if (options.outputDirectory != nullptr) {
+		outputPath = std::filesystem::path(options.outputDirectory) / outputPath.filename();
+	}
+
+	outputPath += options.format == CurveExportFormat::PointFile ? ".polyline.kbp" : ".svg";
+
+	return outputPath.string();
+}
+
+float getParameter(const float option, const float fileValue) {
+	return isnan(option) ? fileValue : option;
+}
+
+// pool is only used to split a single file, see the top of the file.
+FileResult tessellateFile(const char *inputPath, const BatchOptions& options, TessellationThreadPool *pool) {
+	const double startTime = getTime();
+
+	FileResult result;
+
+	MappedPointFile pointFile;
+	std::vector<vec2> importedPoints;
+
+	const vec2 *controlPoints = nullptr;
+	size_t controlPointCount = 0;
+	float tension = 0.0f;
+	float bias = 0.0f;
+	float continuity = 0.0f;
+
+	if (isPointFile(inputPath)) {
+		if (!openPointFile(pointFile, inputPath)) {
+			fprintf(stderr, "%s: not a point file\n", inputPath);
+			return result;
+		}
+
+		controlPoints = pointFile.points;
+		controlPointCount = pointFile.pointCount;
+		tension = pointFile.tension;
+		bias = pointFile.bias;
+		continuity = pointFile.continuity;
+	} else {
+		FILE *input = fopen(inputPath, "rb");
+
+		if (input == nullptr) {
+			fprintf(stderr, "%s: cannot open\n", inputPath);
+			return result;
+		}
+
+		PointImportStatistics statistics;
+		const bool isImported = importPointText(input, pool, importedPoints, statistics);
+		fclose(input);
+
+		if (!isImported) {
+			fprintf(stderr, "%s: read error\n", inputPath);
+			return result;
+		}
+
+		controlPoints = importedPoints.data();
+		controlPointCount = importedPoints.size();
+	}
+
+	BasisTable basisTable;
+	updateBasisTable(
+		basisTable,
+		getParameter(options.tension, tension),
+		getParameter(options.bias, bias),
+		getParameter(options.continuity, continuity),
+		options.stepsPerSegment
+	);
+
+	// The curve is streamed, only the control points are held in memory.
+	const std::string outputPath = getOutputPath(inputPath, options);
+	FILE *output = fopen(outputPath.c_str(), "wb");
+
+	CurveExportStatistics statistics;
+
+	if (output != nullptr) {
+		result.isTessellated = exportCurve(
+			output,
+			options.format,
+			pool,
+			controlPoints,
+			controlPointCount,
+			basisTable,
+			options.method,
+			&statistics
+		);
+
+		result.isTessellated = fclose(output) == 0 && result.isTessellated;
+	}
+
+	if (!result.isTessellated) {
+		fprintf(stderr, "%s: cannot write %s\n", inputPath, outputPath.c_str());
+	}
+
+	closePointFile(pointFile);
+
+	result.controlPointCount = controlPointCount;
+	result.writtenPointCount = statistics.pointCount;
+	result.byteCount = statistics.byteCount;
+	result.seconds = getTime() - startTime;
+
+	return result;
+}
+
+bool parseMethod(const char *name, TessellationMethod& method) {
+	const char *names[] = { "matrix", "forward", "simd", "table" };
+	const TessellationMethod methods[] = {
+		TessellationMethod::Matrix,
+		TessellationMethod::ForwardDifferencing,
+		TessellationMethod::Simd,
+		TessellationMethod::BasisTable
+	};
+
+	for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); ++i) {
+		if (strcmp(name, names[i]) == 0) {
+			method = methods[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool parseFormat(const char *name, CurveExportFormat& format) {
+	const char *names[] = { "kbp", "svg", "svg-bezier" };
+	const CurveExportFormat formats[] = {
+		CurveExportFormat::PointFile,
+		CurveExportFormat::SvgPolyline,
+		CurveExportFormat::SvgBezier
+	};
+
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+		if (strcmp(name, names[i]) == 0) {
+			format = formats[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool parseOptions(const int argc, char **argv, BatchOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		const bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--tension") == 0 && hasValue) {
+			options.tension = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--bias") == 0 && hasValue) {
+			options.bias = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--continuity") == 0 && hasValue) {
+			options.continuity = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--steps") == 0 && hasValue) {
+			options.stepsPerSegment = (size_t)std::max(atoi(argv[++i]), 1);
+		} else if (strcmp(argv[i], "--method") == 0 && hasValue) {
+			if (!parseMethod(argv[++i], options.method)) {
+				return false;
+			}
+		} else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+			options.threadCount = (size_t)std::max(atoi(argv[++i]), 1);
+		} else if (strcmp(argv[i], "--format") == 0 && hasValue) {
+			if (!parseFormat(argv[++i], options.format)) {
+				return false;
+			}
+		} else if (strcmp(argv[i], "--output-dir") == 0 && hasValue) {
+			options.outputDirectory = argv[++i];
+		} else if (strcmp(argv[i], "--quiet") == 0) {
+			options.isQuiet = true;
+		} else if (argv[i][0] == '-' && argv[i][1] == '-') {
+			return false;
+		} else {
+			options.inputPaths.push_back(argv[i]);
+		}
+	}
+
+	return !options.inputPaths.empty();
+}
+
+}
+
+int main(int argc, char **argv) {
+	BatchOptions options;
+
+	if (!parseOptions(argc, argv, options)) {
+		fprintf(stderr,
+			"Usage: %s [--tension T] [--bias B] [--continuity C] [--steps N]\n"
+			"       [--method matrix|forward|simd|table] [--threads N]\n"
+			"       [--format kbp|svg|svg-bezier] [--output-dir dir] [--quiet]\n"
+			"       input...\n",
+			argv[0]);
+		return -1;
+	}
+
+	TessellationThreadPool *pool = createTessellationThreadPool(options.threadCount);
+
+	const size_t fileCount = options.inputPaths.size();
+	const bool isFileParallel = fileCount >= options.threadCount;
+
+	std::vector<FileResult> results(fileCount);
+	std::mutex outputMutex;
+
+	const double startTime = getTime();
+
+	auto processFile = [&](const size_t file, TessellationThreadPool *filePool) {
+		results[file] = tessellateFile(options.inputPaths[file], options, filePool);
+
+		if (!options.isQuiet && results[file].isTessellated) {
+			std::lock_guard<std::mutex> lock(outputMutex);
+
+			printf("%s: %zu points -> %zu points, %zu bytes in %.3f s\n",
+				options.inputPaths[file],
+				results[file].controlPointCount,
+				results[file].writtenPointCount,
+				results[file].byteCount,
+				results[file].seconds
+			);
+		}
+	};
+
+	if (isFileParallel) {
+		runChunksParallel(pool, fileCount, [&](const size_t file) {
+			processFile(file, nullptr);
+		});
+	} else {
+		for (size_t file = 0; file < fileCount; ++file) {
+			processFile(file, pool);
+		}
+	}
+
+	const double seconds = std::max(getTime() - startTime, 1e-9);
+
+	destroyTessellationThreadPool(pool);
+
+	size_t tessellatedFileCount = 0;
+	size_t controlPointCount = 0;
+	size_t writtenPointCount = 0;
+	size_t byteCount = 0;
+
+	for (const FileResult& result : results) {
+		if (result.isTessellated) {
+			++tessellatedFileCount;
+			controlPointCount += result.controlPointCount;
+			writtenPointCount += result.writtenPointCount;
+			byteCount += result.byteCount;
+		}
+	}
+
+	printf("%zu / %zu files, %zu points -> %zu points in %.3f s on %zu threads: %.3g points/s, %.3g written points/s, %.1f MB/s\n",
+		tessellatedFileCount,
+		fileCount,
+		controlPointCount,
+		writtenPointCount,
+		seconds,
+		options.threadCount,
+		(double)controlPointCount / seconds,
+		(double)writtenPointCount / seconds,
+		(double)byteCount / 1e6 / seconds
+	);
+
+	return tessellatedFileCount == fileCount ? 0 : 1;
+}